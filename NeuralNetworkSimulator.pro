@@ -8,13 +8,46 @@ SOURCES += main.cpp \
     mainwindow.cpp \
     ffnetwork.cpp \
     config.cpp \
-    networkmanager.cpp
+    networkmanager.cpp \
+    optimizer.cpp \
+    lmtrainer.cpp \
+    milestonehistory.cpp \
+    placement.cpp \
+    resultcache.cpp \
+    quantizednetwork.cpp \
+    paralleltrainer.cpp \
+    weightsnapshot.cpp \
+    snapshotevaluator.cpp \
+    tracer.cpp \
+    replicaaggregate.cpp \
+    telemetrywriter.cpp \
+    etasearch.cpp \
+    sweepbenchmark.cpp \
+    dataset.cpp \
+    inspector.cpp
 HEADERS += mainwindow.h \
     ffnetwork.h \
     config.h \
-    networkmanager.h
+    networkmanager.h \
+    optimizer.h \
+    lmtrainer.h \
+    milestonehistory.h \
+    placement.h \
+    resultcache.h \
+    quantizednetwork.h \
+    paralleltrainer.h \
+    weightsnapshot.h \
+    snapshotevaluator.h \
+    tracer.h \
+    replicaaggregate.h \
+    telemetrywriter.h \
+    etasearch.h \
+    sweepbenchmark.h \
+    dataset.h \
+    inspector.h
 FORMS += mainwindow.ui \
-    config.ui
+    config.ui \
+    inspector.ui
 INCLUDEPATH += qwt/src
 LIBS += -Lqwt/lib \
     -lqwtd6
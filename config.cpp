@@ -1,6 +1,78 @@
+#include <vector>
+using namespace std;
+
+#include <QStringList>
+
 #include "config.h"
 #include "ui_config.h"
 
+/**
+  * Parses a comma-separated list of numbers, skipping entries that are not
+  * numbers.
+  */
+static QVector<double> parseValues(const QString &text)
+{
+    QVector<double> values;
+    QStringList entries = text.split(',', QString::SkipEmptyParts);
+    for(int e = 0; e < entries.size(); e++)
+    {
+        bool ok;
+        double value = entries[e].trimmed().toDouble(&ok);
+        if(ok)
+            values << value;
+    }
+    return values;
+}
+
+static QString formatValues(const QVector<double> &values)
+{
+    QStringList entries;
+    for(int e = 0; e < values.size(); e++)
+        entries << QString::number(values[e]);
+    return entries.join(", ");
+}
+
+/**
+  * Parses a comma-separated list of hidden layer sizes, where an entry is
+  * one size per hidden layer joined by '-' ("8-4"), or 0 for none.
+  * Entries that do not parse are skipped.
+  */
+static QVector<vector<unsigned int> > parseLayers(const QString &text)
+{
+    QVector<vector<unsigned int> > layers;
+    QStringList entries = text.split(',', QString::SkipEmptyParts);
+    for(int e = 0; e < entries.size(); e++)
+    {
+        QStringList sizes = entries[e].trimmed().split('-');
+        vector<unsigned int> hidden;
+        bool ok = true;
+        for(int s = 0; s < sizes.size() && ok; s++)
+        {
+            unsigned int size = sizes[s].trimmed().toUInt(&ok);
+            if(ok && size > 0)
+                hidden.push_back(size);
+            else if(ok && sizes.size() > 1)
+                ok = false;
+        }
+        if(ok)
+            layers << hidden;
+    }
+    return layers;
+}
+
+static QString formatLayers(const QVector<vector<unsigned int> > &layers)
+{
+    QStringList entries;
+    for(int e = 0; e < layers.size(); e++)
+    {
+        QStringList sizes;
+        for(unsigned int s = 0; s < layers[e].size(); s++)
+            sizes << QString::number(layers[e][s]);
+        entries << (sizes.isEmpty() ? QString("0") : sizes.join("-"));
+    }
+    return entries.join(", ");
+}
+
 Config::Config(QWidget *parent)
     : QDialog(parent), ui(new Ui::ConfigDialog)
 {
@@ -16,25 +88,112 @@ void Config::saveConfig()
     etaStart = ui->etaStartSpinBox->value();
     etaEnd = ui->etaEndSpinBox->value();
     etaIncrement = ui->etaIncrementSpinBox->value();
-    momentum = ui->momentumSpinBox->value();
+    // a list with no valid entry keeps the previous values
+    QVector<double> values = parseValues(ui->momentumLineEdit->text());
+    if(!values.isEmpty())
+        momenta = values;
     averaged = ui->avgSpinBox->value();
-    inputNodes = ui->inputSpinBox->value();
-    outputNodes = ui->outputSpinBox->value();
-    stop = ui->stopSpinBox->value();
+    values = parseValues(ui->stopLineEdit->text());
+    if(!values.isEmpty())
+        stops = values;
+    QVector<vector<unsigned int> > layers = parseLayers(ui->hiddenLineEdit->text());
+    if(!layers.isEmpty())
+        hiddenLayers = layers;
+    pruneFraction = ui->pruneSpinBox->value() / 100.0;
+    optimizer = Optimizer::Type(ui->optimizerComboBox->currentIndex());
+    engine = FFNetwork::Engine(ui->engineComboBox->currentIndex());
+    reportInterval = ui->reportSpinBox->value();
+    reportEpochCap = ui->epochCapSpinBox->value();
+    placement = Placement::Policy(ui->placementComboBox->currentIndex());
+    priority = QThread::Priority(ui->priorityComboBox->currentIndex());
+    historyCapacity = ui->historySpinBox->value();
+    spillDirectory = ui->spillLineEdit->text().trimmed();
+    cacheFile = ui->cacheLineEdit->text().trimmed();
+    workers = ui->workersSpinBox->value();
+    parallelism = FFNetwork::Parallelism(ui->parallelComboBox->currentIndex());
+    // Adam is always trained synchronously (see FFNetwork::setParallelism())
+    if(optimizer == Optimizer::Adam && parallelism == FFNetwork::Hogwild)
+    {
+        parallelism = FFNetwork::Synchronous;
+        ui->parallelComboBox->setCurrentIndex(int(parallelism));
+    }
+    band = ReplicaAggregate::Band(ui->bandComboBox->currentIndex());
+    showReplicas = ui->replicasCheckBox->isChecked();
+    telemetryFile = ui->telemetryLineEdit->text().trimmed();
+    stallWindow = ui->stallWindowSpinBox->value();
+    gradientFloor = ui->gradientFloorSpinBox->value();
+    // the lowest value (1) reads "use the grid"
+    searchBudget = ui->searchSpinBox->value() > 1 ? ui->searchSpinBox->value() : 0;
+    resultsFile = ui->resultsLineEdit->text().trimmed();
 
     emit accept();
 }
 
+/**
+  * Sets the eta grid and training settings of a sweep, as if entered and
+  * saved in the dialog.
+  */
+void Config::setSweep(double _etaStart, double _etaEnd, double _etaIncrement,
+                      double _momentum, double _stop, unsigned int _hidden,
+                      unsigned int _averaged)
+{
+    ui->etaStartSpinBox->setValue(_etaStart);
+    ui->etaEndSpinBox->setValue(_etaEnd);
+    ui->etaIncrementSpinBox->setValue(_etaIncrement);
+    ui->momentumLineEdit->setText(QString::number(_momentum));
+    ui->stopLineEdit->setText(QString::number(_stop));
+    ui->hiddenLineEdit->setText(QString::number(_hidden));
+    ui->avgSpinBox->setValue(_averaged);
+    saveConfig();
+}
+
+/**
+  * Sets the result cache file; an empty name turns the cache off.
+  */
+void Config::setCacheFile(const QString &file)
+{
+    ui->cacheLineEdit->setText(file);
+    saveConfig();
+}
+
+/**
+  * Sets the number of workers per network and how they share the weights.
+  */
+void Config::setParallelism(FFNetwork::Parallelism mode, unsigned int _workers)
+{
+    ui->workersSpinBox->setValue(_workers);
+    ui->parallelComboBox->setCurrentIndex(int(mode));
+    saveConfig();
+}
+
 void Config::cancelConfig()
 {
     ui->etaStartSpinBox->setValue(etaStart);
     ui->etaEndSpinBox->setValue(etaEnd);
     ui->etaIncrementSpinBox->setValue(etaIncrement);
-    ui->momentumSpinBox->setValue(momentum);
+    ui->momentumLineEdit->setText(formatValues(momenta));
     ui->avgSpinBox->setValue(averaged);
-    ui->inputSpinBox->setValue(inputNodes);
-    ui->outputSpinBox->setValue(outputNodes);
-    ui->stopSpinBox->setValue(stop);
+    ui->stopLineEdit->setText(formatValues(stops));
+    ui->hiddenLineEdit->setText(formatLayers(hiddenLayers));
+    ui->pruneSpinBox->setValue(int(pruneFraction * 100.0 + 0.5));
+    ui->optimizerComboBox->setCurrentIndex(int(optimizer));
+    ui->engineComboBox->setCurrentIndex(int(engine));
+    ui->reportSpinBox->setValue(reportInterval);
+    ui->epochCapSpinBox->setValue(reportEpochCap);
+    ui->placementComboBox->setCurrentIndex(int(placement));
+    ui->priorityComboBox->setCurrentIndex(int(priority));
+    ui->historySpinBox->setValue(historyCapacity);
+    ui->spillLineEdit->setText(spillDirectory);
+    ui->cacheLineEdit->setText(cacheFile);
+    ui->workersSpinBox->setValue(workers);
+    ui->parallelComboBox->setCurrentIndex(int(parallelism));
+    ui->bandComboBox->setCurrentIndex(int(band));
+    ui->replicasCheckBox->setChecked(showReplicas);
+    ui->telemetryLineEdit->setText(telemetryFile);
+    ui->stallWindowSpinBox->setValue(stallWindow);
+    ui->gradientFloorSpinBox->setValue(gradientFloor);
+    ui->searchSpinBox->setValue(searchBudget > 1 ? searchBudget : 1);
+    ui->resultsLineEdit->setText(resultsFile);
 
     emit reject();
 }
@@ -54,9 +213,9 @@ double Config::getEtaIncrement() const
     return etaIncrement;
 }
 
-double Config::getMomentum() const
+QVector<double> Config::getMomenta() const
 {
-    return momentum;
+    return momenta;
 }
 
 unsigned int Config::getAveraged() const
@@ -64,17 +223,107 @@ unsigned int Config::getAveraged() const
     return averaged;
 }
 
-unsigned int Config::getInputNodes() const
+QVector<double> Config::getStops() const
+{
+    return stops;
+}
+
+QVector<vector<unsigned int> > Config::getHiddenLayers() const
+{
+    return hiddenLayers;
+}
+
+double Config::getPruneFraction() const
+{
+    return pruneFraction;
+}
+
+Optimizer::Type Config::getOptimizer() const
+{
+    return optimizer;
+}
+
+FFNetwork::Engine Config::getEngine() const
+{
+    return engine;
+}
+
+int Config::getReportInterval() const
+{
+    return reportInterval;
+}
+
+unsigned int Config::getReportEpochCap() const
+{
+    return reportEpochCap;
+}
+
+Placement::Policy Config::getPlacement() const
+{
+    return placement;
+}
+
+QThread::Priority Config::getPriority() const
+{
+    return priority;
+}
+
+int Config::getHistoryCapacity() const
+{
+    return historyCapacity;
+}
+
+QString Config::getSpillDirectory() const
+{
+    return spillDirectory;
+}
+
+QString Config::getCacheFile() const
+{
+    return cacheFile;
+}
+
+unsigned int Config::getWorkers() const
+{
+    return workers;
+}
+
+FFNetwork::Parallelism Config::getParallelism() const
+{
+    return parallelism;
+}
+
+ReplicaAggregate::Band Config::getBand() const
+{
+    return band;
+}
+
+bool Config::getShowReplicas() const
+{
+    return showReplicas;
+}
+
+QString Config::getTelemetryFile() const
+{
+    return telemetryFile;
+}
+
+unsigned int Config::getStallWindow() const
+{
+    return stallWindow;
+}
+
+double Config::getGradientFloor() const
 {
-    return inputNodes;
+    return gradientFloor;
 }
 
-unsigned int Config::getOutputNodes() const
+int Config::getSearchBudget() const
 {
-    return outputNodes;
+    return searchBudget;
 }
 
-double Config::getStop() const
+QString Config::getResultsFile() const
 {
-    return stop;
+    return resultsFile;
 }
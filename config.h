@@ -1,7 +1,16 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+#include <vector>
+
 #include <QDialog>
+#include <QThread>
+#include <QVector>
+
+#include "optimizer.h"
+#include "ffnetwork.h"
+#include "placement.h"
+#include "replicaaggregate.h"
 
 namespace Ui {
     class ConfigDialog;
@@ -13,18 +22,55 @@ class Config : public QDialog
 public:
     Config(QWidget *parent = 0);
 
+    void setSweep(double _etaStart, double _etaEnd, double _etaIncrement,
+                  double _momentum, double _stop, unsigned int _hidden,
+                  unsigned int _averaged);
+    void setCacheFile(const QString &file);
+    void setParallelism(FFNetwork::Parallelism mode, unsigned int _workers);
+
     double getEtaStart() const;
     double getEtaEnd() const;
     double getEtaIncrement() const;
 
-    double getMomentum() const;
+    QVector<double> getMomenta() const;
 
     unsigned int getAveraged() const;
 
-    unsigned int getInputNodes() const;
-    unsigned int getOutputNodes() const;
 
-    double getStop() const;
+    QVector<double> getStops() const;
+
+    QVector<std::vector<unsigned int> > getHiddenLayers() const;
+
+    double getPruneFraction() const;
+
+    Optimizer::Type getOptimizer() const;
+
+    FFNetwork::Engine getEngine() const;
+
+    int getReportInterval() const;
+    unsigned int getReportEpochCap() const;
+
+    Placement::Policy getPlacement() const;
+    QThread::Priority getPriority() const;
+
+    int getHistoryCapacity() const;
+    QString getSpillDirectory() const;
+    QString getCacheFile() const;
+
+    unsigned int getWorkers() const;
+    FFNetwork::Parallelism getParallelism() const;
+
+    ReplicaAggregate::Band getBand() const;
+    bool getShowReplicas() const;
+
+    QString getTelemetryFile() const;
+
+    unsigned int getStallWindow() const;
+    double getGradientFloor() const;
+
+    int getSearchBudget() const;
+
+    QString getResultsFile() const;
 
 private slots:
     void saveConfig();
@@ -35,11 +81,29 @@ private:
     double etaStart;
     double etaEnd;
     double etaIncrement;
-    double momentum;
+    QVector<double> momenta;
     unsigned int averaged;
-    unsigned int inputNodes;
-    unsigned int outputNodes;
-    double stop;
+    QVector<double> stops;
+    QVector<std::vector<unsigned int> > hiddenLayers;
+    double pruneFraction;
+    Optimizer::Type optimizer;
+    FFNetwork::Engine engine;
+    int reportInterval;
+    unsigned int reportEpochCap;
+    Placement::Policy placement;
+    QThread::Priority priority;
+    int historyCapacity;
+    QString spillDirectory;
+    QString cacheFile;
+    unsigned int workers;
+    FFNetwork::Parallelism parallelism;
+    ReplicaAggregate::Band band;
+    bool showReplicas;
+    QString telemetryFile;
+    unsigned int stallWindow;
+    double gradientFloor;
+    int searchBudget;
+    QString resultsFile;
 };
 
 #endif // CONFIG_H
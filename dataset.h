@@ -0,0 +1,53 @@
+#ifndef DATASET_H
+#define DATASET_H
+
+#include <vector>
+
+/**
+  * Training set shared by every network of a sweep: the networks keep a
+  * reference to it instead of a copy each, so it has to outlive them.
+  * Never changes once built.
+  *
+  * Besides the dense rows, the inputs that are not 0 are indexed per row
+  * (CSR, like pruned weights), with their values unless every input is 0
+  * or 1. Networks read a sparse dataset through the index, so the first
+  * layer only sums (and updates) the weights of the inputs that are set.
+  */
+class Dataset
+{
+public:
+    // synthetic tasks over all 2^bits binary input patterns
+    enum Task { Parity, Majority };
+
+    Dataset(Task task, unsigned int bits);
+
+    unsigned int size() const;
+    unsigned int inputSize() const;
+    unsigned int outputSize() const;
+    const std::vector<std::vector<double> > &inputs() const;
+    const std::vector<std::vector<double> > &expected() const;
+    std::vector<unsigned int> topology(const std::vector<unsigned int> &hidden) const;
+
+    bool isBinary() const;
+    bool isSparse() const;
+    double density() const;
+    unsigned int activeCount(unsigned int k) const;
+    const unsigned int *activeColumns(unsigned int k) const;
+    const double *activeValues(unsigned int k) const;
+
+private:
+    std::vector<std::vector<double> > inputRows;
+    std::vector<std::vector<double> > expectedRows;
+
+    // row k's inputs that are not 0 are activeCols[activeRows[k]] up to
+    // (excluding) activeCols[activeRows[k+1]], their values in activeVals
+    // (left empty for a binary dataset)
+    bool binary;
+    std::vector<unsigned int> activeRows;
+    std::vector<unsigned int> activeCols;
+    std::vector<double> activeVals;
+
+    void index();
+};
+
+#endif // DATASET_H
@@ -0,0 +1,120 @@
+#include <cmath>
+
+#include "etasearch.h"
+
+// 1/phi, the fraction of the bracket between an end and the far interior
+// point
+static const double InversePhi = 0.6180339887498949;
+
+EtaSearch::EtaSearch(double _low, double _high, int _budget)
+    : low(_low), high(_high), budget(qMax(_budget, 2))
+{
+    logScale = low > 0.0;
+    a = logScale ? log(low) : low;
+    b = logScale ? log(high) : high;
+    c = b - InversePhi * (b - a);
+    d = a + InversePhi * (b - a);
+    cIndex = propose(c);
+    dIndex = propose(d);
+}
+
+/**
+  * Number of points proposed so far.
+  */
+int EtaSearch::count() const
+{
+    return etas.size();
+}
+
+double EtaSearch::point(int i) const
+{
+    return etas[i];
+}
+
+QVector<double> EtaSearch::points() const
+{
+    return etas;
+}
+
+bool EtaSearch::isReported(int i) const
+{
+    return reported[i];
+}
+
+/**
+  * Records the cost of point i and, once both interior points are known
+  * and budget remains, narrows the bracket and proposes the next point.
+  */
+void EtaSearch::report(int i, double cost)
+{
+    costs[i] = cost;
+    reported[i] = true;
+    if(!reported[cIndex] || !reported[dIndex] || etas.size() >= budget)
+        return;
+
+    if(costs[cIndex] <= costs[dIndex])
+    {
+        // the minimum is in [a, d]
+        b = d;
+        d = c;
+        dIndex = cIndex;
+        c = b - InversePhi * (b - a);
+        cIndex = propose(c);
+    }
+    else
+    {
+        // the minimum is in [c, b]
+        a = c;
+        c = d;
+        cIndex = dIndex;
+        d = a + InversePhi * (b - a);
+        dIndex = propose(d);
+    }
+}
+
+/**
+  * True once the whole budget has been proposed and evaluated.
+  */
+bool EtaSearch::isFinished() const
+{
+    if(etas.size() < budget)
+        return false;
+    for(int i = 0; i < reported.size(); i++)
+    {
+        if(!reported[i])
+            return false;
+    }
+    return true;
+}
+
+/**
+  * Index of the cheapest point evaluated so far, -1 if none is.
+  */
+int EtaSearch::best() const
+{
+    int bestIndex = -1;
+    for(int i = 0; i < etas.size(); i++)
+    {
+        if(reported[i] && (bestIndex == -1 || costs[i] < costs[bestIndex]))
+            bestIndex = i;
+    }
+    return bestIndex;
+}
+
+double EtaSearch::cost(int i) const
+{
+    return costs[i];
+}
+
+bool EtaSearch::sameRange(double _low, double _high, int _budget) const
+{
+    return low == _low && high == _high && budget == qMax(_budget, 2);
+}
+
+int EtaSearch::propose(double x)
+{
+    etas << (logScale ? exp(x) : x);
+    costs << 0.0;
+    reported << false;
+    return etas.size() - 1;
+}
@@ -0,0 +1,50 @@
+#ifndef ETASEARCH_H
+#define ETASEARCH_H
+
+#include <QVector>
+
+/**
+  * Golden-section search for the eta that minimizes a cost (the epochs it
+  * takes to converge), within a budget of evaluated settings. The first two
+  * points are proposed together; after that every evaluation narrows the
+  * bracket and proposes one new point, reusing the other interior point.
+  * Searches on a log scale when the lower bound is above 0, since useful
+  * learning rates span orders of magnitude. Assumes the cost is unimodal
+  * in eta; an infinite cost (nothing converged) counts as worse than any
+  * finite one.
+  */
+class EtaSearch
+{
+public:
+    EtaSearch(double low, double high, int _budget);
+
+    int count() const;
+    double point(int i) const;
+    QVector<double> points() const;
+    bool isReported(int i) const;
+    void report(int i, double cost);
+    bool isFinished() const;
+    int best() const;
+    double cost(int i) const;
+    bool sameRange(double low, double high, int _budget) const;
+
+private:
+    double low;
+    double high;
+    int budget;
+    bool logScale;
+    // bracket [a, b] and interior points c < d, in search coordinates
+    double a;
+    double b;
+    double c;
+    double d;
+    int cIndex;
+    int dIndex;
+    QVector<double> etas;
+    QVector<double> costs;
+    QVector<bool> reported;
+
+    int propose(double x);
+};
+
+#endif // ETASEARCH_H
@@ -3,9 +3,29 @@
 #include <ctime>
 #include <cstdlib>
 #include <cmath>
+#include <algorithm>
 using namespace std;
 
+#include <QDataStream>
+#include <qnumeric.h>
+
 #include "ffnetwork.h"
+#include "lmtrainer.h"
+#include "quantizednetwork.h"
+#include "paralleltrainer.h"
+#include "weightsnapshot.h"
+#include "tracer.h"
+#include "telemetrywriter.h"
+#include "placement.h"
+#include "dataset.h"
+
+// a window's mean error has to be at least this fraction below the
+// previous window's for the network not to count as stalled
+static const double PlateauImprovement = 0.01;
+// gradients are measured every GradientStride epochs for the floor test,
+// and have to be under the floor GradientPatience times in a row
+static const unsigned int GradientStride = 64;
+static const unsigned int GradientPatience = 16;
 
 /**
   * Initializes a feed-foward network with the architecture
@@ -17,26 +37,70 @@ FFNetwork::FFNetwork(int _id,
                      double _eta,
                      double _momentum,
                      double _stop,
-                     vector<vector<double> > _inputs,
-                     vector<vector<double> > _expected) :
-    id(_id), avgId(_avgId), layers(_layers), inputs(_inputs), expected(_expected),
-    eta(_eta), momentum(_momentum), stop(_stop), quitNow(false), successful(false)
+                     Optimizer::Type _optimizer,
+                     const Dataset *_dataset) :
+    id(_id), avgId(_avgId), layers(_layers),
+    dataset(_dataset), inputs(_dataset->inputs()), expected(_dataset->expected()),
+    eta(_eta), momentum(_momentum), stop(_stop),
+    optimizer(Optimizer::create(_optimizer, _eta, _momentum)),
+    engine(Backprop), lm(NULL), parallelism(Hogwild), workers(1), parallel(NULL),
+    quitNow(false), successful(false), status(Training),
+    pruned(false), pruneFraction(0.0), denseNsecs(0), denseEpochs(0),
+    sparseNsecs(0), sparseEpochs(0), reportInterval(250), reportEpochCap(100000),
+    reportEpochs(0), reportErrorSum(0.0), cpu(-1), pinned(false), relocate(false),
+    allocated(false), seed(0), rngState(0), snapshot(NULL), telemetry(NULL),
+    measureGradients(false), stallWindow(0), gradientFloor(0.0)
 {
     assert(layers.size() > 1);
 
+    stateSize = optimizer->stateSize();
+    batch = optimizer->isBatch();
+    gatherInputs = dataset->isSparse();
+    skipZeroInputs = batch || optimizer->ignoresZeroGradients();
+
     running = false;
     epoch = 0;
     error = 0.0;
 
     weights = new double*[layers.size() - 1];
-    prevWeightUpdates = new double*[layers.size() - 1];
+    weightState = new double*[layers.size() - 1];
 
     // need #layers neuron values because neuronVals[0] will hold input values
     neuronVals = new double*[layers.size()];
-    neuronVals[0] = new double[layers[0]];
+    neuronVals[0] = NULL;
 
     delta = new double*[layers.size()-1];
 
+    sparseRows = new unsigned int*[layers.size()-1];
+    sparseCols = new unsigned int*[layers.size()-1];
+
+    // the buffers themselves are only allocated by allocate(), once the
+    // network's thread starts
+    for(unsigned int i = 1; i < layers.size(); i++)
+    {
+        weights[i-1] = NULL;
+        weightState[i-1] = NULL;
+        neuronVals[i] = NULL;
+        delta[i-1] = NULL;
+        sparseRows[i-1] = NULL;
+        sparseCols[i-1] = NULL;
+    }
+    ordering = NULL;
+
+    snapshot = new WeightSnapshot(layers);
+    gradientNorms = new double[layers.size()-1];
+    resetHealth();
+}
+
+/**
+  * Allocates and initializes the weights and training buffers. Called from
+  * the network's own thread, after it has been pinned, so the memory is
+  * first touched (and placed) there.
+  */
+void FFNetwork::allocate()
+{
+    neuronVals[0] = new double[layers[0]];
+
     for(unsigned int i = 1; i < layers.size(); i++)
     {
         // each layer has n*p + n weights
@@ -48,7 +112,7 @@ FFNetwork::FFNetwork(int _id,
         // weights[i-1][j*(p+1)], weights[i-1][j*(p+1)+1], ..., weights[i-1][j*(p+1)+(p-1)]
         // with bias weights[i-1][j*(p+1)+p]
         weights[i-1] = new double[layers[i]*layers[i-1] + layers[i]];
-        prevWeightUpdates[i-1] = new double[layers[i]*layers[i-1] + layers[i]];
+        weightState[i-1] = new double[(layers[i]*layers[i-1] + layers[i]) * stateSize];
 
         // since each layer has n neurons, we need n cells to hold the output
         // of each neuron (-1 or 1)
@@ -60,78 +124,211 @@ FFNetwork::FFNetwork(int _id,
     ordering = new unsigned int[inputs.size()];
 
     fillRandomWeights();
+    allocated = true;
 }
 
 FFNetwork::~FFNetwork()
 {
+    delete parallel;
+    delete snapshot;
+    if(telemetry != NULL)
+        telemetry->retire();
+    delete[] gradientNorms;
     for(unsigned int i = 1; i < layers.size(); i++)
     {
+        delete[] sparseRows[i-1];
+        delete[] sparseCols[i-1];
         delete[] weights[i-1];
-        delete[] prevWeightUpdates[i-1];
+        delete[] weightState[i-1];
         delete[] neuronVals[i];
         delete[] delta[i-1];
     }
     delete[] neuronVals[0];
     delete[] neuronVals;
     delete[] delta;
-    delete[] prevWeightUpdates;
+    delete[] sparseRows;
+    delete[] sparseCols;
+    delete[] weightState;
     delete[] weights;
     delete[] ordering;
+    delete optimizer;
+    delete lm;
 }
 
 void FFNetwork::run()
 {
     vector<double> output;
+    qint64 traceStart = 0;
+
+    mutex.lock();
+    Tracer::setThreadName(QString("network %1/%2").arg(id).arg(avgId));
+    // buffers are only worth moving if the thread is known to stay on
+    // the CPU's node
+    pinned = (cpu >= 0) && Placement::pinCurrentThread(cpu);
+    allocate();
+    publishSnapshot();
+    mutex.unlock();
 
     forever
     {
+        if(Tracer::isEnabled())
+            traceStart = Tracer::now();
         mutex.lock();
-        while(!running)
+        // only waits of more than 10us are worth a trace event
+        if(Tracer::isEnabled() && Tracer::now() - traceStart > 10000)
+            Tracer::complete("lock wait", traceStart, id, avgId);
+        if(!running)
         {
-            runningCond.wait(&mutex);
+            traceStart = Tracer::isEnabled() ? Tracer::now() : 0;
+            while(!running)
+            {
+                runningCond.wait(&mutex);
+            }
+            Tracer::complete("paused", traceStart, id, avgId);
         }
         if(quitNow)
         {
             mutex.unlock();
             return;
         }
+        if(relocate)
+        {
+            moveToLocalNode();
+            relocate = false;
+        }
+
+        if(!reportTimer.isValid())
+        {
+            resetReport();
+            resetHealth();
+        }
 
         epoch++;
         error = 0.0;
-        ordered = 0;
-        while(ordered < inputs.size())
+        epochTimer.start();
+        measureGradients = telemetry != NULL
+                           || (gradientFloor > 0.0 && epoch % GradientStride == 0);
+        if(measureGradients)
         {
-            index = qrand() % inputs.size();
-
-            // check if we've seen this number
-            seen = false;
-            for(unsigned int i = 0; i < ordered; i++)
+            for(unsigned int i = 1; i < layers.size(); i++)
+                gradientNorms[i-1] = 0.0;
+        }
+        if(Tracer::isEnabled())
+            traceStart = Tracer::now();
+        if(engine == LevenbergMarquardt)
+        {
+            if(lm == NULL)
             {
-                if(ordering[i] == index)
+                lm = new LMTrainer(this);
+            }
+            error = lm->iterate();
+            if(measureGradients)
+                lm->gradientNorms(gradientNorms);
+        }
+        else
+        {
+            shuffle();
+            if(workers > 1 && !pruned)
+            {
+                if(parallel == NULL)
+                {
+                    parallel = new ParallelTrainer(this, parallelism, workers, workerCpus);
+                }
+                error = parallel->epoch();
+            }
+            else
+            {
+                for(unsigned int n = 0; n < inputs.size(); n++)
                 {
-                    seen = true;
-                    break;
+                    unsigned int index = ordering[n];
+                    if(!batch)
+                        optimizer->beginStep();
+                    if(pruned)
+                    {
+                        output = processInputSparse(inputs[index]);
+                        // how to measure the error between two multi-dimensional vectors?
+                        error += fabs(output[0] - expected[index][0]);
+                        backpropSparse(output, expected[index]);
+                    }
+                    else
+                    {
+                        error += trainSample(index, neuronVals, delta, NULL);
+                    }
+                    if(measureGradients)
+                        accumulateGradientNorms(neuronVals, delta, gradientNorms);
                 }
             }
-            if(!seen)
+            if(batch)
             {
-                ordering[ordered++] = index;
-                output = processInput(inputs[index]);
-                // how to measure the error between two multi-dimensional vectors?
-                error += fabs(output[0] - expected[index][0]);
-                backprop(output, expected[index]);
+                applyBatchUpdates();
             }
         }
-        if(error < stop)
+        if(pruned)
+        {
+            sparseNsecs += epochTimer.nsecsElapsed();
+            sparseEpochs++;
+        }
+        else
+        {
+            denseNsecs += epochTimer.nsecsElapsed();
+            denseEpochs++;
+        }
+        Tracer::complete("epoch", traceStart, id, avgId, epoch);
+        if(telemetry != NULL)
+            telemetry->record(epoch, error, gradientNorms);
+        reportErrorSum += error;
+        reportEpochs++;
+        if(!qIsFinite(error))
+        {
+            // the weights have blown up; no milestone, the error is useless
+            Tracer::instant("diverged", id, avgId, epoch);
+            running = false;
+            successful = true;
+            status = Diverged;
+            emit epochFailed(id, avgId, epoch, status);
+        }
+        else if(error < stop && pruneFraction > 0.0 && !pruned)
         {
+            // the dense network has converged; remove its smallest weights
+            // and keep training (fine-tuning) until the pruned network
+            // converges as well
+            prune(pruneFraction);
+            delete lm;
+            lm = NULL;
+            publishSnapshot();
+            Tracer::instant("pruned", id, avgId, epoch);
+            emit epochMilestone(id, avgId, epoch, error);
+            resetReport();
+            resetHealth();
+        }
+        else if(error < stop)
+        {
+            // done before the signals, so the manager sees the network as
+            // finished when it handles them
+            publishSnapshot();
+            Tracer::instant("converged", id, avgId, epoch);
+            running = false;
+            status = Converged;
+            successful = true;
             emit epochMilestone(id, avgId, epoch, error);
             emit epochFinal(id, avgId, epoch);
+        }
+        else if(isStalled())
+        {
+            publishSnapshot();
+            Tracer::instant("stalled", id, avgId, epoch);
+            emit epochMilestone(id, avgId, epoch, reportErrorSum / reportEpochs);
             running = false;
             successful = true;
+            status = Stalled;
+            emit epochFailed(id, avgId, epoch, status);
         }
-        else if(epoch % 1000 == 0)
+        else if(reportTimer.elapsed() >= reportInterval || reportEpochs >= reportEpochCap)
         {
-            emit epochMilestone(id, avgId, epoch, error);
+            publishSnapshot();
+            Tracer::instant("milestone emitted", id, avgId, epoch);
+            emit epochMilestone(id, avgId, epoch, reportErrorSum / reportEpochs);
+            resetReport();
         }
         mutex.unlock();
     }
@@ -147,15 +344,34 @@ void FFNetwork::restart()
     mutex.lock();
     running = false;
     successful = false;
+    status = Training;
     epoch = 0;
     error = 0.0;
-    fillRandomWeights();
+    denseNsecs = sparseNsecs = 0;
+    denseEpochs = sparseEpochs = 0;
+    reportTimer.invalidate();
+    optimizer->reset();
+    delete lm;
+    lm = NULL;
+    if(allocated)
+    {
+        if(pruned)
+        {
+            densify();
+            // densify() allocated from this (the GUI) thread
+            relocate = pinned;
+        }
+        fillRandomWeights();
+        publishSnapshot();
+    }
     mutex.unlock();
 }
 
 void FFNetwork::pause()
 {
     mutex.lock();
+    if(running)
+        Tracer::instant("pause", id, avgId);
     running = false;
     mutex.unlock();
 }
@@ -165,6 +381,8 @@ void FFNetwork::resume()
     mutex.lock();
     if(!successful)
     {
+        if(!running)
+            Tracer::instant("resume", id, avgId);
         running = true;
         runningCond.wakeAll();
     }
@@ -174,15 +392,379 @@ void FFNetwork::resume()
 void FFNetwork::cancel()
 {
     mutex.lock();
+    Tracer::instant("cancel", id, avgId, epoch);
     running = false;
+    if(!successful)
+        status = Canceled;
     successful = true;
     mutex.unlock();
 }
 
+void FFNetwork::setEngine(Engine _engine)
+{
+    mutex.lock();
+    engine = _engine;
+    mutex.unlock();
+}
+
+void FFNetwork::setReporting(int intervalMsecs, unsigned int epochCap)
+{
+    mutex.lock();
+    reportInterval = intervalMsecs;
+    reportEpochCap = epochCap;
+    mutex.unlock();
+}
+
+void FFNetwork::setId(int _id)
+{
+    mutex.lock();
+    id = _id;
+    mutex.unlock();
+}
+
+/**
+  * CPU for the network's thread and, when training data-parallel, for
+  * each helper worker (workerCpus[w] for worker w; entry 0 is unused).
+  */
+void FFNetwork::setPlacement(int _cpu, QVector<int> _workerCpus)
+{
+    mutex.lock();
+    cpu = _cpu;
+    if(_workerCpus != workerCpus)
+    {
+        workerCpus = _workerCpus;
+        delete parallel;
+        parallel = NULL;
+    }
+    mutex.unlock();
+}
+
+/**
+  * Trains each dense epoch with the given number of workers (1 for
+  * sequential training). Optimizers that count steps (Adam's bias
+  * correction) need one tick per update in order, which Hogwild workers
+  * cannot give them, so they are always trained synchronously.
+  */
+void FFNetwork::setParallelism(Parallelism mode, unsigned int _workers)
+{
+    if(optimizer->countsSteps())
+        mode = Synchronous;
+    mutex.lock();
+    if(mode != parallelism || _workers != workers)
+    {
+        parallelism = mode;
+        workers = qMax(_workers, 1u);
+        delete parallel;
+        parallel = NULL;
+    }
+    mutex.unlock();
+}
+
+/**
+  * Records every epoch to channel from now on (NULL to stop recording),
+  * retiring the previous channel.
+  */
+void FFNetwork::setTelemetry(TelemetryChannel *channel)
+{
+    mutex.lock();
+    if(telemetry != NULL)
+        telemetry->retire();
+    telemetry = channel;
+    mutex.unlock();
+}
+
+/**
+  * Sets the plateau window (in epochs) and the gradient floor of the
+  * stall tests; 0 turns a test off. Divergence is always checked.
+  */
+void FFNetwork::setHealthChecks(unsigned int window, double floor)
+{
+    mutex.lock();
+    if(window != stallWindow)
+    {
+        stallWindow = window;
+        resetHealth();
+    }
+    gradientFloor = floor;
+    mutex.unlock();
+}
+
+/**
+  * Why the network stopped, or Training while it has not.
+  */
+FFNetwork::Status FFNetwork::getStatus() const
+{
+    return status;
+}
+
+/**
+  * Takes effect on the next (re)start.
+  */
+void FFNetwork::setSeed(quint32 _seed)
+{
+    mutex.lock();
+    seed = _seed;
+    mutex.unlock();
+}
+
+/**
+  * Marks the network as having converged after finalEpoch epochs without
+  * training it, for results that are already known.
+  */
+void FFNetwork::setCachedResult(int finalEpoch)
+{
+    mutex.lock();
+    running = false;
+    successful = true;
+    status = Converged;
+    epoch = finalEpoch;
+    mutex.unlock();
+}
+
+/**
+  * Everything that determines the outcome of training this network: the
+  * topology, hyperparameters, training and health-check settings, seed
+  * and dataset. Two reproducible networks (see isReproducible()) with the
+  * same signature train identically.
+  */
+QByteArray FFNetwork::signature() const
+{
+    QByteArray bytes;
+    QDataStream out(&bytes, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_6);
+
+    // bump when a change to the training code alters results
+    out << quint32(4);
+    out << quint32(layers.size());
+    for(unsigned int i = 0; i < layers.size(); i++)
+        out << quint32(layers[i]);
+    out << eta << momentum << stop << pruneFraction;
+    out << (engine == LevenbergMarquardt ? QString("Levenberg-Marquardt") : optimizer->name());
+    out << seed;
+    out << quint32(workers > 1 ? workers : 1) << quint32(workers > 1 ? parallelism : 0);
+    out << quint32(stallWindow) << gradientFloor;
+    out << quint32(inputs.size());
+    for(unsigned int k = 0; k < inputs.size(); k++)
+    {
+        for(unsigned int j = 0; j < inputs[k].size(); j++)
+            out << inputs[k][j];
+        for(unsigned int j = 0; j < expected[k].size(); j++)
+            out << expected[k][j];
+    }
+    return bytes;
+}
+
+/**
+  * Whether the run is determined by the signature alone. Hogwild workers
+  * race on the shared weights, so which update lands first (and with it
+  * the epoch of convergence) differs from run to run.
+  */
+bool FFNetwork::isReproducible() const
+{
+    return workers <= 1 || parallelism != Hogwild;
+}
+
+/**
+  * Copies the current weights (dense; pruned weights as zeros) into the
+  * snapshot. Called with the mutex held, which keeps the snapshot to one
+  * writer at a time.
+  */
+void FFNetwork::publishSnapshot()
+{
+    double *w = snapshot->beginWrite();
+    for(unsigned int i = 1; i < layers.size(); i++)
+    {
+        unsigned int p = layers[i-1];
+        if(pruned)
+        {
+            for(unsigned int n = 0; n < layers[i]*(p+1); n++)
+            {
+                w[n] = 0.0;
+            }
+            for(unsigned int j = 0; j < layers[i]; j++)
+            {
+                unsigned int rowEnd = sparseRows[i-1][j+1] - 1;
+                for(unsigned int n = sparseRows[i-1][j]; n < rowEnd; n++)
+                {
+                    w[j*(p+1) + sparseCols[i-1][n]] = weights[i-1][n];
+                }
+                w[j*(p+1) + p] = weights[i-1][rowEnd];
+            }
+        }
+        else
+        {
+            for(unsigned int n = 0; n < layers[i]*(p+1); n++)
+            {
+                w[n] = weights[i-1][n];
+            }
+        }
+        w += layers[i]*(p+1);
+    }
+    snapshot->endWrite(epoch);
+}
+
+/**
+  * Latest published weights; safe to read from any thread.
+  */
+const WeightSnapshot *FFNetwork::getSnapshot() const
+{
+    return snapshot;
+}
+
+void FFNetwork::resetReport()
+{
+    reportTimer.start();
+    reportEpochs = 0;
+    reportErrorSum = 0.0;
+}
+
+void FFNetwork::resetHealth()
+{
+    windowEpochs = 0;
+    windowErrorSum = 0.0;
+    previousWindowMean = -1.0;
+    lowGradients = 0;
+}
+
+/**
+  * Runs the stall tests on the epoch just trained. A Levenberg-Marquardt
+  * trainer that is stuck has stalled whatever the tests say.
+  */
+bool FFNetwork::isStalled()
+{
+    if(engine == LevenbergMarquardt && lm != NULL && lm->isStuck())
+        return true;
+
+    if(stallWindow > 0)
+    {
+        windowErrorSum += error;
+        if(++windowEpochs == stallWindow)
+        {
+            double mean = windowErrorSum / windowEpochs;
+            bool plateau = previousWindowMean >= 0.0
+                           && mean > (1.0 - PlateauImprovement) * previousWindowMean;
+            previousWindowMean = mean;
+            windowEpochs = 0;
+            windowErrorSum = 0.0;
+            if(plateau)
+                return true;
+        }
+    }
+
+    if(gradientFloor > 0.0 && measureGradients)
+    {
+        double sum = 0.0;
+        for(unsigned int i = 1; i < layers.size(); i++)
+            sum += gradientNorms[i-1];
+        if(sqrt(sum / inputs.size()) < gradientFloor)
+        {
+            if(++lowGradients >= GradientPatience)
+                return true;
+        }
+        else
+        {
+            lowGradients = 0;
+        }
+    }
+    return false;
+}
+
+void FFNetwork::setPruneFraction(double fraction)
+{
+    mutex.lock();
+    pruneFraction = fraction;
+    mutex.unlock();
+}
+
+bool FFNetwork::isPruned() const
+{
+    return pruned;
+}
+
+/**
+  * Fraction of the dense weights (including biases) that are still stored.
+  */
+double FFNetwork::density() const
+{
+    unsigned int stored = 0;
+    unsigned int dense = 0;
+    for(unsigned int i = 1; i < layers.size(); i++)
+    {
+        stored += weightCount(i);
+        dense += layers[i]*layers[i-1] + layers[i];
+    }
+    return double(stored) / double(dense);
+}
+
+/**
+  * Ratio of the mean dense epoch time to the mean sparse epoch time.
+  */
+double FFNetwork::sparseSpeedup() const
+{
+    if(denseEpochs == 0 || sparseEpochs == 0 || sparseNsecs == 0)
+        return 1.0;
+    return (double(denseNsecs) / denseEpochs) / (double(sparseNsecs) / sparseEpochs);
+}
+
 QString FFNetwork::toString()
 {
-    return QString("id %1, eta %2, momentum %3")
-            .arg(id).arg(eta).arg(momentum);
+    QString topology = QString::number(layers[0]);
+    for(unsigned int i = 1; i < layers.size(); i++)
+        topology += QString("-%1").arg(layers[i]);
+    QString s = QString("id %1, %2, eta %3, momentum %4, stop %5, %6")
+                .arg(id).arg(topology).arg(eta).arg(momentum).arg(stop)
+                .arg(engine == LevenbergMarquardt ? QString("Levenberg-Marquardt")
+                                                  : optimizer->name());
+    if(workers > 1 && engine == Backprop)
+    {
+        s += QString(", %1 workers (%2)").arg(workers)
+             .arg(parallelism == Hogwild ? QString("Hogwild") : QString("synchronous"));
+    }
+    if(pruned)
+    {
+        s += QString(", density %1, speedup %2x")
+             .arg(density(), 0, 'f', 2).arg(sparseSpeedup(), 0, 'f', 2);
+    }
+    return s;
+}
+
+/**
+  * Quantizes the latest weight snapshot to int8 and compares it with the
+  * double weights on the training set: outputs classified (at 0.5) the
+  * same as the targets by each model, the largest output difference and
+  * the model sizes. Works on the snapshot, so it never stalls training;
+  * empty before the first snapshot.
+  */
+QString FFNetwork::quantizationReport()
+{
+    vector<double> w;
+    unsigned int snapshotEpoch;
+    if(!snapshot->read(w, snapshotEpoch))
+        return QString();
+
+    QuantizedNetwork quantized(layers, w, inputs);
+    unsigned int outputs = layers[layers.size()-1];
+    unsigned int correct = 0;
+    unsigned int quantizedCorrect = 0;
+    double maxDiff = 0.0;
+    for(unsigned int k = 0; k < inputs.size(); k++)
+    {
+        vector<double> output = snapshot->forward(w, inputs[k]);
+        vector<double> quantizedOutput = quantized.evaluate(inputs[k]);
+        for(unsigned int j = 0; j < outputs; j++)
+        {
+            bool target = expected[k][j] >= 0.5;
+            correct += ((output[j] >= 0.5) == target);
+            quantizedCorrect += ((quantizedOutput[j] >= 0.5) == target);
+            maxDiff = max(maxDiff, fabs(output[j] - quantizedOutput[j]));
+        }
+    }
+
+    return QString("int8 (%1): %2/%3 correct (double %4/%3), max output difference %5, "
+                   "%6 -> %7 bytes")
+           .arg(quantized.kernelName()).arg(quantizedCorrect).arg(inputs.size() * outputs)
+           .arg(correct).arg(maxDiff, 0, 'f', 4)
+           .arg(snapshot->size() * sizeof(double)).arg(quantized.sizeBytes());
 }
 
 void FFNetwork::quit()
@@ -194,17 +776,369 @@ void FFNetwork::quit()
     mutex.unlock();
 }
 
+template<typename T> static void reallocate(T *&array, unsigned int size)
+{
+    T *local = new T[size];
+    for(unsigned int k = 0; k < size; k++)
+    {
+        local[k] = array[k];
+    }
+    delete[] array;
+    array = local;
+}
+
+/**
+  * Re-allocates the training buffers from the worker thread, so the
+  * kernel's first-touch policy places them on the NUMA node of the CPU the
+  * worker is pinned to. The dataset is shared by all networks and read
+  * only, so it stays where it is.
+  */
+void FFNetwork::moveToLocalNode()
+{
+    reallocate(neuronVals[0], layers[0]);
+    for(unsigned int i = 1; i < layers.size(); i++)
+    {
+        if(pruned)
+        {
+            reallocate(sparseRows[i-1], layers[i]+1);
+            reallocate(sparseCols[i-1], weightCount(i));
+        }
+        reallocate(weights[i-1], weightCount(i));
+        reallocate(weightState[i-1], weightCount(i) * stateSize);
+        reallocate(neuronVals[i], layers[i]);
+        reallocate(delta[i-1], layers[i]);
+    }
+    reallocate(ordering, inputs.size());
+}
+
 void FFNetwork::fillRandomWeights()
 {
+    // every run starts the generator over (the state must be non-zero)
+    rngState = (quint64(seed) << 1 | 1) * Q_UINT64_C(0x9E3779B97F4A7C15);
+
     for(unsigned int i = 1; i < layers.size(); i++)
     {
         for(unsigned int j = 0; j < (layers[i]*layers[i-1] + layers[i]); j++)
         {
             // random floating-point number between -1 and 1
-            weights[i-1][j] = (rand() - RAND_MAX/2)/static_cast<double>(RAND_MAX/2);
+            weights[i-1][j] = 2.0*random() - 1.0;
 
-            // set previous weight update to 0.0
-            prevWeightUpdates[i-1][j] = 0.0;
+            optimizer->initState(&weightState[i-1][j*stateSize]);
+        }
+    }
+}
+
+/**
+  * Uniform random number in [0, 1) from the network's xorshift64*
+  * generator.
+  */
+double FFNetwork::random()
+{
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return double((rngState * Q_UINT64_C(2685821657736338717)) >> 11) / 9007199254740992.0;
+}
+
+/**
+  * Fisher-Yates shuffle of the sample order for the next epoch.
+  */
+void FFNetwork::shuffle()
+{
+    unsigned int n = inputs.size();
+    for(unsigned int k = 0; k < n; k++)
+    {
+        ordering[k] = k;
+    }
+    for(unsigned int k = n; k > 1; k--)
+    {
+        unsigned int r = (unsigned int)(random() * k);
+        swap(ordering[k-1], ordering[r]);
+    }
+}
+
+/**
+  * Number of weights (including biases) stored for the weights going
+  * into layer i.
+  */
+unsigned int FFNetwork::weightCount(unsigned int i) const
+{
+    if(pruned)
+        return sparseRows[i-1][layers[i]];
+    return layers[i]*layers[i-1] + layers[i];
+}
+
+/**
+  * Magnitude pruning: on every layer, removes the given fraction of
+  * (non-bias) weights with the smallest magnitude and switches the network
+  * to CSR storage. Each CSR row holds the surviving weights of one neuron
+  * in input order, always followed by its bias.
+  */
+void FFNetwork::prune(double fraction)
+{
+    assert(!pruned);
+
+    vector<double> magnitudes;
+    for(unsigned int i = 1; i < layers.size(); i++)
+    {
+        unsigned int p = layers[i-1];
+
+        magnitudes.clear();
+        for(unsigned int j = 0; j < layers[i]; j++)
+            for(unsigned int w = 0; w < p; w++)
+                magnitudes.push_back(fabs(weights[i-1][j*(p+1) + w]));
+
+        // weights with a magnitude at or below the threshold are removed
+        unsigned int removed = static_cast<unsigned int>(fraction * magnitudes.size());
+        double threshold = -1.0;
+        if(removed > 0)
+        {
+            nth_element(magnitudes.begin(), magnitudes.begin() + (removed-1), magnitudes.end());
+            threshold = magnitudes[removed-1];
+        }
+
+        unsigned int nnz = layers[i];
+        for(unsigned int j = 0; j < layers[i]; j++)
+            for(unsigned int w = 0; w < p; w++)
+                if(fabs(weights[i-1][j*(p+1) + w]) > threshold)
+                    nnz++;
+
+        sparseRows[i-1] = new unsigned int[layers[i]+1];
+        sparseCols[i-1] = new unsigned int[nnz];
+        double *packedWeights = new double[nnz];
+        double *packedState = new double[nnz*stateSize];
+
+        unsigned int n = 0;
+        for(unsigned int j = 0; j < layers[i]; j++)
+        {
+            sparseRows[i-1][j] = n;
+            for(unsigned int w = 0; w <= p; w++)
+            {
+                // w == p is the bias, which is never pruned
+                if(w == p || fabs(weights[i-1][j*(p+1) + w]) > threshold)
+                {
+                    sparseCols[i-1][n] = w;
+                    packedWeights[n] = weights[i-1][j*(p+1) + w];
+                    for(unsigned int k = 0; k < stateSize; k++)
+                    {
+                        packedState[n*stateSize + k] =
+                                weightState[i-1][(j*(p+1) + w)*stateSize + k];
+                    }
+                    n++;
+                }
+            }
+        }
+        sparseRows[i-1][layers[i]] = n;
+
+        delete[] weights[i-1];
+        delete[] weightState[i-1];
+        weights[i-1] = packedWeights;
+        weightState[i-1] = packedState;
+    }
+    pruned = true;
+}
+
+/**
+  * Converts a pruned network back to dense storage (pruned weights are 0).
+  */
+void FFNetwork::densify()
+{
+    assert(pruned);
+
+    for(unsigned int i = 1; i < layers.size(); i++)
+    {
+        unsigned int p = layers[i-1];
+        double *denseWeights = new double[layers[i]*p + layers[i]];
+        double *denseState = new double[(layers[i]*p + layers[i]) * stateSize];
+        for(unsigned int j = 0; j < (layers[i]*p + layers[i]); j++)
+        {
+            denseWeights[j] = 0.0;
+            optimizer->initState(&denseState[j*stateSize]);
+        }
+        for(unsigned int j = 0; j < layers[i]; j++)
+        {
+            for(unsigned int n = sparseRows[i-1][j]; n < sparseRows[i-1][j+1]; n++)
+            {
+                unsigned int b = j*(p+1) + sparseCols[i-1][n];
+                denseWeights[b] = weights[i-1][n];
+                for(unsigned int k = 0; k < stateSize; k++)
+                {
+                    denseState[b*stateSize + k] = weightState[i-1][n*stateSize + k];
+                }
+            }
+        }
+
+        delete[] weights[i-1];
+        delete[] weightState[i-1];
+        delete[] sparseRows[i-1];
+        delete[] sparseCols[i-1];
+        weights[i-1] = denseWeights;
+        weightState[i-1] = denseState;
+        sparseRows[i-1] = NULL;
+        sparseCols[i-1] = NULL;
+    }
+    pruned = false;
+}
+
+/**
+  * Hands the negative error gradient of weight b on weight layer a to the
+  * optimizer, or accumulates it until the end of the epoch for batch
+  * optimizers.
+  */
+inline void FFNetwork::updateWeight(unsigned int a, unsigned int b, double gradient)
+{
+    double *state = &weightState[a][b*stateSize];
+    if(batch)
+        state[0] += gradient;
+    else
+        weights[a][b] += optimizer->step(gradient, state);
+}
+
+/**
+  * Steps a batch optimizer with the gradients accumulated over the epoch.
+  */
+void FFNetwork::applyBatchUpdates()
+{
+    double gradient;
+    double *state;
+    optimizer->beginStep();
+    for(unsigned int i = 1; i < layers.size(); i++)
+    {
+        for(unsigned int n = 0; n < weightCount(i); n++)
+        {
+            state = &weightState[i-1][n*stateSize];
+            gradient = state[0];
+            state[0] = 0.0;
+            weights[i-1][n] += optimizer->step(gradient, state);
+        }
+    }
+}
+
+unsigned int FFNetwork::numWeights() const
+{
+    unsigned int n = 0;
+    for(unsigned int i = 1; i < layers.size(); i++)
+    {
+        n += weightCount(i);
+    }
+    return n;
+}
+
+/**
+  * Copies every stored weight, layer by layer in storage order, into w.
+  */
+void FFNetwork::getWeights(double *w) const
+{
+    for(unsigned int i = 1; i < layers.size(); i++)
+    {
+        for(unsigned int n = 0; n < weightCount(i); n++)
+        {
+            *w++ = weights[i-1][n];
+        }
+    }
+}
+
+void FFNetwork::setWeights(const double *w)
+{
+    for(unsigned int i = 1; i < layers.size(); i++)
+    {
+        for(unsigned int n = 0; n < weightCount(i); n++)
+        {
+            weights[i-1][n] = *w++;
+        }
+    }
+}
+
+vector<double> FFNetwork::forward(const vector<double> &input)
+{
+    if(pruned)
+        return processInputSparse(input);
+    return processInput(input);
+}
+
+/**
+  * Fills row (in getWeights() order) with the derivative of output neuron
+  * o with respect to every stored weight, for the input last passed to
+  * forward().
+  */
+void FFNetwork::outputGradient(unsigned int o, double *row)
+{
+    unsigned int last = layers.size()-1;
+    unsigned int offset = numWeights();
+    unsigned int rowEnd;
+
+    for(unsigned int j = 0; j < layers[last]; j++)
+    {
+        delta[last-1][j] = (j == o) ? neuronVals[last][j] * (1 - neuronVals[last][j]) : 0.0;
+    }
+
+    for(unsigned int i = last; i > 0; i--)
+    {
+        unsigned int p = layers[i-1];
+        offset -= weightCount(i);
+
+        if(pruned)
+        {
+            for(unsigned int j = 0; j < layers[i]; j++)
+            {
+                rowEnd = sparseRows[i-1][j+1] - 1;
+                for(unsigned int n = sparseRows[i-1][j]; n < rowEnd; n++)
+                {
+                    row[offset + n] = delta[i-1][j] * neuronVals[i-1][sparseCols[i-1][n]];
+                }
+                row[offset + rowEnd] = delta[i-1][j];
+            }
+            if(i == 1) break;
+
+            for(unsigned int j = 0; j < p; j++)
+            {
+                delta[i-2][j] = 0.0;
+            }
+            for(unsigned int k = 0; k < layers[i]; k++)
+            {
+                rowEnd = sparseRows[i-1][k+1] - 1;
+                for(unsigned int n = sparseRows[i-1][k]; n < rowEnd; n++)
+                {
+                    delta[i-2][sparseCols[i-1][n]] += weights[i-1][n] * delta[i-1][k];
+                }
+            }
+            for(unsigned int j = 0; j < p; j++)
+            {
+                delta[i-2][j] *= neuronVals[i-1][j] * (1 - neuronVals[i-1][j]);
+            }
+        }
+        else
+        {
+            for(unsigned int j = 0; j < layers[i]; j++)
+            {
+                for(unsigned int w = 0; w < p; w++)
+                {
+                    row[offset + j*(p+1) + w] = delta[i-1][j] * neuronVals[i-1][w];
+                }
+                row[offset + j*(p+1) + p] = delta[i-1][j];
+            }
+            if(i == 1) break;
+
+            // accumulated row by row (an outer product) rather than summed
+            // down each column, which would stride by p+1 doubles
+            double *dBelow = delta[i-2];
+            for(unsigned int j = 0; j < p; j++)
+            {
+                dBelow[j] = 0.0;
+            }
+            for(unsigned int k = 0; k < layers[i]; k++)
+            {
+                const double *w = &weights[i-1][k*(p+1)];
+                double d = delta[i-1][k];
+                for(unsigned int j = 0; j < p; j++)
+                {
+                    dBelow[j] += w[j] * d;
+                }
+            }
+            for(unsigned int j = 0; j < p; j++)
+            {
+                dBelow[j] *= neuronVals[i-1][j] * (1 - neuronVals[i-1][j]);
+            }
         }
     }
 }
@@ -250,73 +1184,265 @@ vector<double> FFNetwork::processInput(vector<double> input)
     return output;
 }
 
-void FFNetwork::backprop(vector<double> output, vector<double> expected)
+/**
+  * Updates weight b on weight layer a with the given gradient, or adds it
+  * to layerGradients (that layer's slice of a gradient buffer) instead.
+  */
+inline void FFNetwork::applyGradient(unsigned int a, unsigned int b, double gradient,
+                                     double *layerGradients)
 {
-    double sum;
-    double weightUpdate;
-    int weightIndexA, weightIndexB;
+    if(layerGradients != NULL)
+        layerGradients[b] += gradient;
+    else
+        updateWeight(a, b, gradient);
+}
 
-    // adjust weights on output layer
+/**
+  * One training step on sample k with dense weights: forward pass, output
+  * deltas, then, layer by layer downwards, a single sweep over each weight
+  * row that both gathers the deltas of the layer below (from the weight's
+  * value before the update) and updates the weight. Only the current and
+  * the next layer's activations and deltas are live at any point, so they
+  * stay in L1. Activations and deltas go to vals and deltas (the network's
+  * own buffers, or a parallel worker's). If gradients is given, the
+  * gradients are added to it (in getWeights() order) and the weights are
+  * left alone. Returns the sample's error.
+  *
+  * With a sparse dataset the first layer only sums the weights of the set
+  * inputs, and only those weights get a gradient where the zero gradients
+  * of the others would change nothing (a gradient buffer, a batch
+  * optimizer or plain gradient descent). The inputs that are 0 add
+  * nothing to the sums, so the results are the same to the bit.
+  */
+double FFNetwork::trainSample(unsigned int k, double **vals, double **deltas, double *gradients)
+{
+    unsigned int last = layers.size()-1;
+    const double *in = &inputs[k][0];
+    const double *target = &expected[k][0];
+    const unsigned int *cols = gatherInputs ? dataset->activeColumns(k) : NULL;
+    const double *values = gatherInputs ? dataset->activeValues(k) : NULL;
+    unsigned int active = gatherInputs ? dataset->activeCount(k) : 0;
+    double sum;
 
-    // for each output neuron
-    for(unsigned int j = 0; j < layers[layers.size()-1]; j++)
+    for(unsigned int w = 0; w < layers[0]; w++)
     {
-        delta[layers.size()-2][j] = output[j] * (1 - output[j]) *
-                                    (expected[j] - output[j]);
+        vals[0][w] = in[w];
+    }
 
-        // for each weight going to output layer
-        // (ignore bias when counting with w)
-        for(unsigned int w = 0; w < layers[layers.size()-2]; w++)
+    for(unsigned int i = 1; i <= last; i++)
+    {
+        unsigned int p = layers[i-1];
+        const double *below = vals[i-1];
+        double *out = vals[i];
+        for(unsigned int j = 0; j < layers[i]; j++)
         {
-            weightIndexA = layers.size()-2;
-            weightIndexB = j*(layers[layers.size()-2]+1) + w;
+            const double *row = &weights[i-1][j*(p+1)];
+            sum = row[p];
+            if(i == 1 && gatherInputs && values == NULL)
+            {
+                // binary inputs: every set input is 1
+                for(unsigned int c = 0; c < active; c++)
+                {
+                    sum += row[cols[c]];
+                }
+            }
+            else if(i == 1 && gatherInputs)
+            {
+                for(unsigned int c = 0; c < active; c++)
+                {
+                    sum += values[c] * row[cols[c]];
+                }
+            }
+            else
+            {
+                for(unsigned int w = 0; w < p; w++)
+                {
+                    sum += below[w] * row[w];
+                }
+            }
+            out[j] = sigmoid(sum);
+        }
+    }
+
+    const double *output = vals[last];
+    for(unsigned int j = 0; j < layers[last]; j++)
+    {
+        deltas[last-1][j] = output[j] * (1 - output[j]) * (target[j] - output[j]);
+    }
+
+    unsigned int offset = numWeights();
+    for(unsigned int i = last; i > 0; i--)
+    {
+        unsigned int p = layers[i-1];
+        const double *below = vals[i-1];
+        const double *d = deltas[i-1];
+        double *dBelow = (i > 1) ? deltas[i-2] : NULL;
+        offset -= layers[i]*(p+1);
+        double *layerGradients = (gradients != NULL) ? gradients + offset : NULL;
+        bool skipZeros = (i == 1) && gatherInputs && (layerGradients != NULL || skipZeroInputs);
 
-            weightUpdate = eta * delta[layers.size()-2][j] * neuronVals[layers.size()-2][w] +
-                           momentum * prevWeightUpdates[weightIndexA][weightIndexB];
-            weights[weightIndexA][weightIndexB] += weightUpdate;
-            prevWeightUpdates[weightIndexA][weightIndexB] = weightUpdate;
+        if(dBelow != NULL)
+        {
+            for(unsigned int w = 0; w < p; w++)
+            {
+                dBelow[w] = 0.0;
+            }
+        }
+        for(unsigned int j = 0; j < layers[i]; j++)
+        {
+            unsigned int base = j*(p+1);
+            const double *row = &weights[i-1][base];
+            if(dBelow != NULL)
+            {
+                // gathered before the update, so the delta comes from the
+                // weight as it was when the output was computed (textbook
+                // backprop). The old two-pass backprop() read the weights
+                // above after updating them; with per-sample optimizers the
+                // numerics differ from it, batch training is unaffected
+                for(unsigned int w = 0; w < p; w++)
+                {
+                    dBelow[w] += row[w] * d[j];
+                    applyGradient(i-1, base + w, d[j] * below[w], layerGradients);
+                }
+            }
+            else if(skipZeros)
+            {
+                for(unsigned int c = 0; c < active; c++)
+                {
+                    applyGradient(i-1, base + cols[c], d[j] * below[cols[c]], layerGradients);
+                }
+            }
+            else
+            {
+                for(unsigned int w = 0; w < p; w++)
+                {
+                    applyGradient(i-1, base + w, d[j] * below[w], layerGradients);
+                }
+            }
+            // update bias
+            applyGradient(i-1, base + p, d[j], layerGradients);
+        }
+        if(dBelow != NULL)
+        {
+            for(unsigned int w = 0; w < p; w++)
+            {
+                dBelow[w] *= below[w] * (1 - below[w]);
+            }
         }
-        // update bias
-        weightIndexA = layers.size()-2;
-        weightIndexB = j*(layers[layers.size()-2]+1) + layers[layers.size()-2];
-        weightUpdate = eta * delta[layers.size()-2][j]
-                       + momentum * prevWeightUpdates[weightIndexA][weightIndexB];
-        weights[weightIndexA][weightIndexB] += weightUpdate;
-        prevWeightUpdates[weightIndexA][weightIndexB] = weightUpdate;
     }
 
-    // for each hidden layer (backwards)
-    for(unsigned int i = layers.size()-2; i > 0; i--)
+    // how to measure the error between two multi-dimensional vectors?
+    return fabs(output[0] - target[0]);
+}
+
+/**
+  * Adds the squared gradient norm of every weight layer for the sample
+  * whose activations and deltas are in vals and deltas. A layer's gradient
+  * is the outer product of its deltas with its inputs and bias, so its
+  * squared norm is |delta|^2 * (|input|^2 + 1), which costs O(n + p)
+  * instead of O(n*p). For a pruned network this is the norm of the dense
+  * gradient, pruned connections included.
+  */
+void FFNetwork::accumulateGradientNorms(double **vals, double **deltas, double *norms) const
+{
+    for(unsigned int i = 1; i < layers.size(); i++)
+    {
+        double deltaSquares = 0.0;
+        for(unsigned int j = 0; j < layers[i]; j++)
+            deltaSquares += deltas[i-1][j] * deltas[i-1][j];
+        double inputSquares = 1.0;
+        for(unsigned int w = 0; w < layers[i-1]; w++)
+            inputSquares += vals[i-1][w] * vals[i-1][w];
+        norms[i-1] += deltaSquares * inputSquares;
+    }
+}
+
+vector<double> FFNetwork::processInputSparse(vector<double> input)
+{
+    assert(input.size() == layers[0]);
+
+    for(unsigned i = 0; i < layers[0]; i++)
+    {
+        neuronVals[0][i] = input[i];
+    }
+
+    double sum;
+    unsigned int rowEnd;
+    for(unsigned int i = 1; i < layers.size(); i++)
     {
-        // for each neuron on this layer
         for(unsigned int j = 0; j < layers[i]; j++)
         {
             sum = 0.0;
-            // for every neuron that j connects to (forward)
-            for(unsigned int k = 0; k < layers[i+1]; k++)
+
+            // the last entry of each row is the bias
+            rowEnd = sparseRows[i-1][j+1] - 1;
+            for(unsigned int n = sparseRows[i-1][j]; n < rowEnd; n++)
             {
-                sum += weights[i][k*(layers[i]+1) + j] * delta[i][k];
+                sum += neuronVals[i-1][sparseCols[i-1][n]] * weights[i-1][n];
             }
-            delta[i-1][j] = neuronVals[i][j] * (1 - neuronVals[i][j]) * sum;
+            sum += weights[i-1][rowEnd];
+
+            neuronVals[i][j] = sigmoid(sum);
+        }
+    }
+
+    vector<double> output = vector<double>(layers[layers.size()-1]);
+    for(unsigned int j = 0; j < layers[layers.size()-1]; j++)
+    {
+        output[j] = neuronVals[layers.size()-1][j];
+    }
+    return output;
+}
+
+/**
+  * Same update rule as trainSample(), over the CSR weights only: a single
+  * sweep over each stored row scatters the deltas of the layer below (from
+  * the weight's value before the update) and updates the weight.
+  */
+void FFNetwork::backpropSparse(vector<double> output, vector<double> expected)
+{
+    unsigned int rowEnd;
+    unsigned int last = layers.size()-1;
 
-            // for each weight going to this layer
-            // (ignore bias when counting with w)
+    for(unsigned int j = 0; j < layers[last]; j++)
+    {
+        delta[last-1][j] = output[j] * (1 - output[j]) * (expected[j] - output[j]);
+    }
+
+    // for each layer (backwards), find the deltas of the layer below and
+    // update the weights going into it
+    for(unsigned int i = last; i > 0; i--)
+    {
+        const double *below = neuronVals[i-1];
+        const double *d = delta[i-1];
+        double *dBelow = (i > 1) ? delta[i-2] : NULL;
+
+        if(dBelow != NULL)
+        {
             for(unsigned int w = 0; w < layers[i-1]; w++)
             {
-                weightIndexA = i-1;
-                weightIndexB = j*(layers[i]+1) + w;
-                weightUpdate = eta * delta[i-1][j] * neuronVals[i-i][w]
-                               + momentum * prevWeightUpdates[weightIndexA][weightIndexB];
-                weights[weightIndexA][weightIndexB] += weightUpdate;
-                prevWeightUpdates[weightIndexA][weightIndexB] = weightUpdate;
+                dBelow[w] = 0.0;
+            }
+        }
+        for(unsigned int j = 0; j < layers[i]; j++)
+        {
+            rowEnd = sparseRows[i-1][j+1] - 1;
+            for(unsigned int n = sparseRows[i-1][j]; n < rowEnd; n++)
+            {
+                unsigned int w = sparseCols[i-1][n];
+                if(dBelow != NULL)
+                    dBelow[w] += weights[i-1][n] * d[j];
+                updateWeight(i-1, n, d[j] * below[w]);
             }
             // update bias
-            weightIndexA = i-1;
-            weightIndexB = j*(layers[i]+1) + layers[i];
-            weightUpdate = eta * delta[i-1][j]
-                           + momentum * prevWeightUpdates[weightIndexA][weightIndexB];
-            weights[weightIndexA][weightIndexB] += weightUpdate;
-            prevWeightUpdates[weightIndexA][weightIndexB] = weightUpdate;
+            updateWeight(i-1, rowEnd, d[j]);
+        }
+        if(dBelow != NULL)
+        {
+            for(unsigned int w = 0; w < layers[i-1]; w++)
+            {
+                dBelow[w] *= below[w] * (1 - below[w]);
+            }
         }
     }
 }
@@ -6,19 +6,36 @@
 #include <QThread>
 #include <QMutex>
 #include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QByteArray>
+#include <QVector>
+
+#include "optimizer.h"
+
+class LMTrainer;
+class ParallelTrainer;
+class WeightSnapshot;
+class TelemetryChannel;
+class Dataset;
 
 class FFNetwork : public QThread
 {
 Q_OBJECT
+friend class LMTrainer;
+friend class ParallelTrainer;
 public:
+    enum Engine { Backprop, LevenbergMarquardt };
+    enum Parallelism { Hogwild, Synchronous };
+    enum Status { Training, Converged, Diverged, Stalled, Canceled };
+
     FFNetwork(int _id,
               int _avgId,
               std::vector<unsigned int> _layers,
               double _eta,
               double _momentum,
               double _stop,
-              std::vector<std::vector<double> > _inputs,
-              std::vector<std::vector<double> > _expected);
+              Optimizer::Type _optimizer,
+              const Dataset *_dataset);
     ~FFNetwork();
     bool isSuccessful() const;
     void restart();
@@ -27,40 +44,157 @@ public:
     void cancel();
     void run();
     void quit();
+    void setId(int _id);
+    void setEngine(Engine _engine);
+    void setPruneFraction(double fraction);
+    void setReporting(int intervalMsecs, unsigned int epochCap);
+    void setPlacement(int _cpu, QVector<int> _workerCpus = QVector<int>());
+    void setParallelism(Parallelism mode, unsigned int _workers);
+    void setSeed(quint32 _seed);
+    void setCachedResult(int finalEpoch);
+    void setTelemetry(TelemetryChannel *channel);
+    void setHealthChecks(unsigned int window, double floor);
+    Status getStatus() const;
+    QByteArray signature() const;
+    bool isReproducible() const;
+    bool isPruned() const;
+    double density() const;
+    double sparseSpeedup() const;
     QString toString();
+    QString quantizationReport();
+    const WeightSnapshot *getSnapshot() const;
 
 signals:
     void epochMilestone(int id, int avgId, int epoch, double error);
     void epochFinal(int id, int avgId, int epoch);
+    void epochFailed(int id, int avgId, int epoch, int status);
 
 private:
     int id;
     int avgId;
     std::vector<unsigned int> layers;
-    std::vector<std::vector<double> > inputs;
-    std::vector<std::vector<double> > expected;
+    // the shared dataset and its rows
+    const Dataset *dataset;
+    const std::vector<std::vector<double> > &inputs;
+    const std::vector<std::vector<double> > &expected;
     double **weights;
-    double **prevWeightUpdates;
+    // per-weight optimizer state, stateSize doubles for every weight
+    double **weightState;
     double **neuronVals;
     double **delta;
     double eta;
     double momentum;
     double stop;
+    Optimizer *optimizer;
+    unsigned int stateSize;
+    bool batch;
+    // sum the first layer over the dataset's set inputs only, and also
+    // skip the updates of the other first-layer weights where their zero
+    // gradients make no difference
+    bool gatherInputs;
+    bool skipZeroInputs;
+    Engine engine;
+    LMTrainer *lm;
+    Parallelism parallelism;
+    unsigned int workers;
+    ParallelTrainer *parallel;
     QMutex mutex;
     QWaitCondition runningCond;
     bool running;
     unsigned int epoch;
     double error;
     unsigned int *ordering;
-    unsigned int ordered;
-    unsigned int index;
-    bool seen;
     bool quitNow;
+    // successful is set once the network is done, for whatever reason;
+    // status says why
     bool successful;
+    Status status;
+
+    // sparse (CSR) connectivity, only used once the network is pruned;
+    // sparseRows[i-1] holds layers[i]+1 row offsets into weights[i-1] and
+    // sparseCols[i-1] the input each stored weight comes from (layers[i-1]
+    // means the bias)
+    bool pruned;
+    double pruneFraction;
+    unsigned int **sparseRows;
+    unsigned int **sparseCols;
+    QElapsedTimer epochTimer;
+    qint64 denseNsecs;
+    unsigned int denseEpochs;
+    qint64 sparseNsecs;
+    unsigned int sparseEpochs;
+
+    // milestones are emitted once reportInterval msecs have passed or
+    // reportEpochCap epochs have run since the last one, whichever is first,
+    // with the mean error over those epochs
+    int reportInterval;
+    unsigned int reportEpochCap;
+    QElapsedTimer reportTimer;
+    unsigned int reportEpochs;
+    double reportErrorSum;
+
+    // CPU the worker pins itself to (-1 for none); buffers allocated from
+    // another thread are moved to the worker's node when relocate is set,
+    // which only happens if pinning succeeded
+    int cpu;
+    QVector<int> workerCpus;
+    bool pinned;
+    bool relocate;
+    bool allocated;
+
+    // the initial weights and the sample order are drawn from the
+    // network's own generator, restarted from seed on every (re)start, so
+    // a run is reproducible from its configuration and seed
+    quint32 seed;
+    quint64 rngState;
+
+    // weights published for readers on other threads, at every milestone
+    WeightSnapshot *snapshot;
+
+    // every epoch is recorded to telemetry when it is set, with the
+    // squared gradient norm of each weight layer summed in gradientNorms
+    TelemetryChannel *telemetry;
+    double *gradientNorms;
+    // set for the epochs whose gradient norms are summed: all of them when
+    // there is telemetry, otherwise every few for the gradient floor test
+    bool measureGradients;
+
+    // a network is stalled once the mean error of a window of stallWindow
+    // epochs is barely below that of the window before, or once its
+    // gradient stays under gradientFloor (per-sample RMS) for a while;
+    // 0 turns either test off
+    unsigned int stallWindow;
+    double gradientFloor;
+    unsigned int windowEpochs;
+    double windowErrorSum;
+    double previousWindowMean;
+    unsigned int lowGradients;
 
+    void allocate();
     void fillRandomWeights();
+    double random();
+    void shuffle();
+    void moveToLocalNode();
+    void prune(double fraction);
+    unsigned int weightCount(unsigned int i) const;
+    void densify();
+    void updateWeight(unsigned int a, unsigned int b, double gradient);
+    void applyBatchUpdates();
+    void resetReport();
+    void resetHealth();
+    bool isStalled();
+    void publishSnapshot();
+    unsigned int numWeights() const;
+    void getWeights(double *w) const;
+    void setWeights(const double *w);
+    std::vector<double> forward(const std::vector<double> &input);
+    void outputGradient(unsigned int o, double *row);
     std::vector<double> processInput(std::vector<double> input);
-    void backprop(std::vector<double> output, std::vector<double> expected);
+    std::vector<double> processInputSparse(std::vector<double> input);
+    void applyGradient(unsigned int a, unsigned int b, double gradient, double *layerGradients);
+    double trainSample(unsigned int k, double **vals, double **deltas, double *gradients);
+    void accumulateGradientNorms(double **vals, double **deltas, double *norms) const;
+    void backpropSparse(std::vector<double> output, std::vector<double> expected);
     double sigmoid(double x);
 };
 
@@ -0,0 +1,130 @@
+#include <vector>
+using namespace std;
+
+#include <QTimer>
+
+#include "inspector.h"
+#include "ui_inspector.h"
+#include "networkmanager.h"
+#include "ffnetwork.h"
+#include "weightsnapshot.h"
+#include "dataset.h"
+
+const int Inspector::RefreshMsecs = 500;
+
+static QString formatRow(const double *values, unsigned int count)
+{
+    QString row;
+    for(unsigned int k = 0; k < count; k++)
+        row += QString(" %1").arg(values[k], 7, 'f', 3);
+    return row;
+}
+
+Inspector::Inspector(NetworkManager *_manager, QWidget *parent)
+    : QDialog(parent), ui(new Ui::InspectorDialog), manager(_manager)
+{
+    ui->setupUi(this);
+    timer = new QTimer(this);
+    timer->setInterval(RefreshMsecs);
+    connect(timer, SIGNAL(timeout()), this, SLOT(refresh()));
+    connect(ui->networkComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(refresh()));
+    connect(ui->patternSpinBox, SIGNAL(valueChanged(int)), this, SLOT(refresh()));
+    connect(ui->closeButton, SIGNAL(clicked()), this, SLOT(hide()));
+    connect(manager, SIGNAL(networksChanged()), this, SLOT(networksChanged()));
+    networksChanged();
+}
+
+Inspector::~Inspector()
+{
+    delete ui;
+}
+
+void Inspector::showEvent(QShowEvent *e)
+{
+    QDialog::showEvent(e);
+    refresh();
+    timer->start();
+}
+
+void Inspector::hideEvent(QHideEvent *e)
+{
+    timer->stop();
+    QDialog::hideEvent(e);
+}
+
+/**
+  * Lists the manager's new networks, keeping the selection where it
+  * still exists.
+  */
+void Inspector::networksChanged()
+{
+    int selected = ui->networkComboBox->currentIndex();
+    networks = manager->getNetworks();
+
+    ui->networkComboBox->blockSignals(true);
+    ui->networkComboBox->clear();
+    for(int n = 0; n < networks.size(); n++)
+        ui->networkComboBox->addItem(networks[n]->toString());
+    if(selected >= networks.size())
+        selected = networks.size() - 1;
+    ui->networkComboBox->setCurrentIndex(qMax(selected, 0));
+    ui->networkComboBox->blockSignals(false);
+
+    const Dataset *dataset = manager->getDataset();
+    ui->patternSpinBox->setMaximum(qMax(int(dataset->size()) - 1, 0));
+    refresh();
+}
+
+void Inspector::refresh()
+{
+    int n = ui->networkComboBox->currentIndex();
+    if(!isVisible() || n < 0 || n >= networks.size())
+        return;
+
+    vector<double> weights;
+    unsigned int epoch;
+    const WeightSnapshot *snapshot = networks[n]->getSnapshot();
+    if(!snapshot->read(weights, epoch))
+    {
+        ui->reportEdit->setPlainText("no snapshot yet");
+        return;
+    }
+
+    QString report = QString("snapshot of epoch %1").arg(epoch);
+    unsigned int cleanEpoch;
+    double cleanError;
+    if(manager->cleanError(networks[n], cleanEpoch, cleanError))
+        report += QString(", clean error %1 at epoch %2").arg(cleanError).arg(cleanEpoch);
+    report += "\n";
+
+    // one line per neuron: its incoming weights, then its bias
+    const vector<unsigned int> &layers = snapshot->getLayers();
+    const double *w = &weights[0];
+    for(unsigned int i = 1; i < layers.size(); i++)
+    {
+        unsigned int p = layers[i-1];
+        report += QString("\nweights %1 -> %2 (bias last):\n").arg(i-1).arg(i);
+        for(unsigned int j = 0; j < layers[i]; j++)
+        {
+            report += QString("  %1:").arg(j, 3) + formatRow(w + j*(p+1), p)
+                      + " |" + formatRow(w + j*(p+1) + p, 1) + "\n";
+        }
+        w += layers[i]*(p+1);
+    }
+
+    const Dataset *dataset = manager->getDataset();
+    unsigned int k = ui->patternSpinBox->value();
+    if(k < dataset->size())
+    {
+        const vector<double> &expected = dataset->expected()[k];
+        vector<vector<double> > vals = snapshot->activations(weights, dataset->inputs()[k]);
+        report += QString("\nactivations for pattern %1 (expected%2):\n")
+                  .arg(k).arg(formatRow(&expected[0], expected.size()));
+        for(unsigned int i = 0; i < vals.size(); i++)
+        {
+            report += QString("  layer %1:").arg(i)
+                      + formatRow(&vals[i][0], vals[i].size()) + "\n";
+        }
+    }
+    ui->reportEdit->setPlainText(report);
+}
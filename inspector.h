@@ -0,0 +1,46 @@
+#ifndef INSPECTOR_H
+#define INSPECTOR_H
+
+#include <QDialog>
+#include <QVector>
+
+class NetworkManager;
+class FFNetwork;
+class QTimer;
+
+namespace Ui {
+    class InspectorDialog;
+}
+
+/**
+  * Shows the weights of a network and its activations for one input
+  * pattern, both from the network's latest weight snapshot, next to the
+  * snapshot evaluator's clean error. Reading a snapshot never blocks the
+  * network, so inspecting it does not slow its training. While shown, the
+  * view is refreshed every RefreshMsecs.
+  */
+class Inspector : public QDialog
+{
+    Q_OBJECT
+public:
+    Inspector(NetworkManager *_manager, QWidget *parent = 0);
+    ~Inspector();
+
+protected:
+    void showEvent(QShowEvent *e);
+    void hideEvent(QHideEvent *e);
+
+private:
+    static const int RefreshMsecs;
+
+    Ui::InspectorDialog *ui;
+    NetworkManager *manager;
+    QVector<FFNetwork*> networks;
+    QTimer *timer;
+
+private slots:
+    void networksChanged();
+    void refresh();
+};
+
+#endif // INSPECTOR_H
@@ -0,0 +1,224 @@
+#include <vector>
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+#include "lmtrainer.h"
+#include "ffnetwork.h"
+
+// mu never grows beyond this; a step this damped is a tiny gradient step
+static const double MaxMu = 1e10;
+
+// steps tried (mu raised tenfold after each) per iteration
+static const unsigned int MaxAttempts = 16;
+
+LMTrainer::LMTrainer(FFNetwork *_network)
+    : network(_network)
+{
+    numWeights = network->numWeights();
+    numResiduals = network->inputs.size() * network->layers[network->layers.size()-1];
+
+    jacobian.resize(numResiduals * numWeights);
+    residuals.resize(numResiduals);
+    hessian.resize(numWeights * numWeights);
+    gradient.resize(numWeights);
+    system.resize(numWeights * numWeights);
+    step.resize(numWeights);
+    savedWeights.resize(numWeights);
+    reset();
+}
+
+void LMTrainer::reset()
+{
+    mu = 0.001;
+    stuck = false;
+}
+
+double LMTrainer::getMu() const
+{
+    return mu;
+}
+
+bool LMTrainer::isStuck() const
+{
+    return stuck;
+}
+
+/**
+  * Squared norm of each weight layer's slice of the last iteration's
+  * full-batch gradient J^T e.
+  */
+void LMTrainer::gradientNorms(double *normSquares) const
+{
+    unsigned int n = 0;
+    for(unsigned int i = 1; i < network->layers.size(); i++)
+    {
+        normSquares[i-1] = 0.0;
+        for(unsigned int b = 0; b < network->weightCount(i); b++, n++)
+        {
+            normSquares[i-1] += gradient[n] * gradient[n];
+        }
+    }
+}
+
+/**
+  * One Levenberg-Marquardt iteration; returns the summed absolute error
+  * (the same measure backprop epochs report) of the resulting weights.
+  */
+double LMTrainer::iterate()
+{
+    double sse;
+    buildJacobian();
+    double error = evaluate(&sse);
+
+    // J^T J and J^T e
+    for(unsigned int a = 0; a < numWeights; a++)
+    {
+        for(unsigned int b = 0; b <= a; b++)
+        {
+            double sum = 0.0;
+            for(unsigned int r = 0; r < numResiduals; r++)
+            {
+                sum += jacobian[r*numWeights + a] * jacobian[r*numWeights + b];
+            }
+            hessian[a*numWeights + b] = sum;
+            hessian[b*numWeights + a] = sum;
+        }
+        double sum = 0.0;
+        for(unsigned int r = 0; r < numResiduals; r++)
+        {
+            sum += jacobian[r*numWeights + a] * residuals[r];
+        }
+        gradient[a] = sum;
+    }
+
+    network->getWeights(&savedWeights[0]);
+
+    // raise mu until a step lowers the squared error; if none does within
+    // the attempts, keep the current weights (and the raised mu for the
+    // next iteration), unless mu has reached its cap: then no iteration
+    // can do better and the trainer is stuck
+    for(unsigned int attempt = 0; attempt < MaxAttempts; attempt++)
+    {
+        if(solve())
+        {
+            for(unsigned int a = 0; a < numWeights; a++)
+            {
+                step[a] += savedWeights[a];
+            }
+            network->setWeights(&step[0]);
+
+            double newSse;
+            double newError = evaluate(&newSse);
+            if(newSse < sse)
+            {
+                mu = max(mu / 10.0, 1e-20);
+                return newError;
+            }
+            network->setWeights(&savedWeights[0]);
+        }
+        if(mu >= MaxMu)
+        {
+            stuck = true;
+            break;
+        }
+        mu = min(mu * 10.0, MaxMu);
+    }
+    return error;
+}
+
+/**
+  * Runs the whole training set through the network, filling in the
+  * residuals; returns the summed absolute error of the first output.
+  */
+double LMTrainer::evaluate(double *sse)
+{
+    unsigned int outputs = network->layers[network->layers.size()-1];
+    double error = 0.0;
+    *sse = 0.0;
+    for(unsigned int s = 0; s < network->inputs.size(); s++)
+    {
+        vector<double> output = network->forward(network->inputs[s]);
+        for(unsigned int o = 0; o < outputs; o++)
+        {
+            residuals[s*outputs + o] = network->expected[s][o] - output[o];
+            *sse += residuals[s*outputs + o] * residuals[s*outputs + o];
+        }
+        error += fabs(output[0] - network->expected[s][0]);
+    }
+    return error;
+}
+
+void LMTrainer::buildJacobian()
+{
+    unsigned int outputs = network->layers[network->layers.size()-1];
+    for(unsigned int s = 0; s < network->inputs.size(); s++)
+    {
+        network->forward(network->inputs[s]);
+        for(unsigned int o = 0; o < outputs; o++)
+        {
+            network->outputGradient(o, &jacobian[(s*outputs + o)*numWeights]);
+        }
+    }
+}
+
+/**
+  * Solves (J^T J + mu I) step = J^T e by Cholesky decomposition; returns
+  * false if the damped matrix is not positive definite.
+  */
+bool LMTrainer::solve()
+{
+    unsigned int n = numWeights;
+    for(unsigned int a = 0; a < n*n; a++)
+    {
+        system[a] = hessian[a];
+    }
+    for(unsigned int a = 0; a < n; a++)
+    {
+        system[a*n + a] += mu;
+    }
+
+    // lower triangle of system becomes L with L L^T = system
+    for(unsigned int j = 0; j < n; j++)
+    {
+        double d = system[j*n + j];
+        for(unsigned int k = 0; k < j; k++)
+        {
+            d -= system[j*n + k] * system[j*n + k];
+        }
+        if(d <= 0.0)
+            return false;
+        d = sqrt(d);
+        system[j*n + j] = d;
+        for(unsigned int i = j+1; i < n; i++)
+        {
+            double sum = system[i*n + j];
+            for(unsigned int k = 0; k < j; k++)
+            {
+                sum -= system[i*n + k] * system[j*n + k];
+            }
+            system[i*n + j] = sum / d;
+        }
+    }
+
+    // forward substitution (L y = g), then back substitution (L^T x = y)
+    for(unsigned int i = 0; i < n; i++)
+    {
+        double sum = gradient[i];
+        for(unsigned int k = 0; k < i; k++)
+        {
+            sum -= system[i*n + k] * step[k];
+        }
+        step[i] = sum / system[i*n + i];
+    }
+    for(unsigned int i = n; i-- > 0;)
+    {
+        double sum = step[i];
+        for(unsigned int k = i+1; k < n; k++)
+        {
+            sum -= system[k*n + i] * step[k];
+        }
+        step[i] = sum / system[i*n + i];
+    }
+    return true;
+}
@@ -0,0 +1,48 @@
+#ifndef LMTRAINER_H
+#define LMTRAINER_H
+
+#include <vector>
+
+class FFNetwork;
+
+/**
+  * Full-batch Levenberg-Marquardt training engine for small networks.
+  * Each iterate() builds the Jacobian of every network output with respect
+  * to every stored weight from the network's own forward pass, then solves
+  * (J^T J + mu I) dw = J^T e, adjusting mu until the squared error drops.
+  * The cost is cubic in the number of weights, so it is meant for networks
+  * with at most a few hundred of them.
+  *
+  * Once not even a step damped with the largest mu lowers the error, the
+  * trainer is stuck: the weights sit in a minimum it cannot leave.
+  */
+class LMTrainer
+{
+public:
+    LMTrainer(FFNetwork *_network);
+    double iterate();
+    void reset();
+    double getMu() const;
+    bool isStuck() const;
+    void gradientNorms(double *normSquares) const;
+
+private:
+    FFNetwork *network;
+    unsigned int numWeights;
+    unsigned int numResiduals;
+    double mu;
+    bool stuck;
+    std::vector<double> jacobian;
+    std::vector<double> residuals;
+    std::vector<double> hessian;
+    std::vector<double> gradient;
+    std::vector<double> system;
+    std::vector<double> step;
+    std::vector<double> savedWeights;
+
+    double evaluate(double *sse);
+    void buildJacobian();
+    bool solve();
+};
+
+#endif // LMTRAINER_H
@@ -4,14 +4,55 @@
 using namespace std;
 
 #include <QtGui/QApplication>
+#include <QStringList>
 
 #include "mainwindow.h"
+#include "tracer.h"
+#include "sweepbenchmark.h"
 
 int main(int argc, char *argv[])
 {
     qsrand(time(NULL));
     QApplication app(argc, argv);
+
+    // --trace <file> writes a Chrome trace of the training and scheduling
+    QStringList args = app.arguments();
+    int trace = args.indexOf("--trace");
+    if(trace >= 0 && trace + 1 < args.size())
+    {
+        if(!Tracer::start(args[trace + 1]))
+            cerr << "cannot write trace file " << args[trace + 1].toAscii().data() << endl;
+    }
+
+    // --compare-workers <n> trains the standard sweeps with 1 and with n
+    // workers per network and prints epochs and wall time side by side
+    int compare = args.indexOf("--compare-workers");
+    if(compare >= 0 && compare + 1 < args.size())
+    {
+        SweepBenchmark sweeps(QString(), 0.0);
+        int result = sweeps.compareWorkers(qMax(args[compare + 1].toUInt(), 1u));
+        Tracer::stop();
+        return result;
+    }
+
+    // --benchmark <baseline> runs the standard sweeps without a window and
+    // compares them with the baseline (--tolerance <percent>, default 10),
+    // or writes the baseline with --record
+    int benchmark = args.indexOf("--benchmark");
+    if(benchmark >= 0 && benchmark + 1 < args.size())
+    {
+        int tolerance = args.indexOf("--tolerance");
+        double percent = (tolerance >= 0 && tolerance + 1 < args.size())
+                         ? args[tolerance + 1].toDouble() : 10.0;
+        SweepBenchmark sweeps(args[benchmark + 1], percent / 100.0);
+        int result = sweeps.run(args.contains("--record"));
+        Tracer::stop();
+        return result;
+    }
+
     MainWindow w;
     w.show();
-    return app.exec();
+    int result = app.exec();
+    Tracer::stop();
+    return result;
 }
@@ -4,6 +4,7 @@ using namespace std;
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include "networkmanager.h"
+#include "inspector.h"
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
@@ -22,6 +23,9 @@ MainWindow::MainWindow(QWidget *parent) :
     networkManager = new NetworkManager(plot);
     networkManager->networksFromConfig(config);
 
+    inspector = new Inspector(networkManager, this);
+    connect(ui->inspectButton, SIGNAL(clicked()), inspector, SLOT(show()));
+
     plot->setAxisTitle(QwtPlot::yLeft, QString("Error"));
     plot->setAxisTitle(QwtPlot::xBottom, QString("Epoch"));
 
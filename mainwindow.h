@@ -10,6 +10,7 @@
 #include "config.h"
 
 class NetworkManager;
+class Inspector;
 
 namespace Ui {
     class MainWindow;
@@ -29,6 +30,7 @@ private:
     NetworkManager *networkManager;
     QwtPlot *plot;
     Config *config;
+    Inspector *inspector;
     QMutex mutex;
 
 private slots:
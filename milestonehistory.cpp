@@ -0,0 +1,232 @@
+#include "milestonehistory.h"
+
+/**
+  * With continueSpill, points are appended to an existing spill file
+  * instead of replacing it.
+  */
+MilestoneHistory::MilestoneHistory(int _capacity, QString spillFileName, bool continueSpill)
+    : pendingCount(0), recentStart(0), recentCount(0), dirty(false)
+{
+    // a quarter of the points stay at full resolution, the rest are two
+    // points per bucket (including the bucket still being filled)
+    if(_capacity < 16)
+        _capacity = 16;
+    recent = _capacity / 4;
+    maxBuckets = (_capacity - recent) / 2 - 1;
+    bucketSize = 1;
+    recentEpochs.resize(recent);
+    recentErrors.resize(recent);
+
+    if(!spillFileName.isEmpty())
+    {
+        spillFile.setFileName(spillFileName);
+        QIODevice::OpenMode mode = continueSpill ? QIODevice::Append : QIODevice::Truncate;
+        if(spillFile.open(QIODevice::WriteOnly | mode))
+        {
+            spill.setDevice(&spillFile);
+        }
+    }
+}
+
+MilestoneHistory::~MilestoneHistory()
+{
+    if(spillFile.isOpen())
+        spillFile.close();
+}
+
+void MilestoneHistory::append(double epoch, double error)
+{
+    if(spillFile.isOpen())
+    {
+        spill << epoch << error;
+    }
+    add(epoch, error);
+}
+
+/**
+  * Takes over the points of a previous history, which are either in the
+  * spill file already or predate it, so they are not spilled again.
+  */
+void MilestoneHistory::restore(const QVector<double> &epochs, const QVector<double> &errors)
+{
+    for(int i = 0; i < epochs.size(); i++)
+    {
+        add(epochs[i], errors[i]);
+    }
+}
+
+void MilestoneHistory::add(double epoch, double error)
+{
+    int slot;
+    if(recentCount == recent)
+    {
+        // the oldest point leaves the window and its slot takes the new one
+        slot = recentStart;
+        age(recentEpochs[slot], recentErrors[slot]);
+        recentStart = (recentStart + 1) % recent;
+    }
+    else
+    {
+        slot = (recentStart + recentCount++) % recent;
+    }
+    recentEpochs[slot] = epoch;
+    recentErrors[slot] = error;
+    dirty = true;
+}
+
+void MilestoneHistory::clear()
+{
+    buckets.clear();
+    pendingCount = 0;
+    bucketSize = 1;
+    recentStart = 0;
+    recentCount = 0;
+    dirty = true;
+    if(spillFile.isOpen())
+    {
+        spillFile.resize(0);
+        spillFile.seek(0);
+    }
+}
+
+bool MilestoneHistory::isEmpty() const
+{
+    return recentCount == 0;
+}
+
+double MilestoneHistory::lastEpoch() const
+{
+    return recentEpochs[(recentStart + recentCount - 1) % recent];
+}
+
+const QVector<double> &MilestoneHistory::epochs() const
+{
+    if(dirty)
+        rebuild();
+    return epochData;
+}
+
+const QVector<double> &MilestoneHistory::errors() const
+{
+    if(dirty)
+        rebuild();
+    return errorData;
+}
+
+/**
+  * Name of the open spill file, empty if there is none.
+  */
+QString MilestoneHistory::spillFileName() const
+{
+    return spillFile.isOpen() ? spillFile.fileName() : QString();
+}
+
+/**
+  * Moves a point that left the full-resolution window into the bucket
+  * being filled.
+  */
+void MilestoneHistory::age(double epoch, double error)
+{
+    if(pendingCount == 0)
+    {
+        pending[0] = pending[2] = epoch;
+        pending[1] = pending[3] = error;
+    }
+    else
+    {
+        // keep the lower and the higher error, in epoch order
+        bool firstIsMin = pending[1] <= pending[3];
+        double minEpoch = firstIsMin ? pending[0] : pending[2];
+        double minError = firstIsMin ? pending[1] : pending[3];
+        double maxEpoch = firstIsMin ? pending[2] : pending[0];
+        double maxError = firstIsMin ? pending[3] : pending[1];
+        if(error < minError) { minEpoch = epoch; minError = error; }
+        if(error > maxError) { maxEpoch = epoch; maxError = error; }
+        bool minFirst = minEpoch <= maxEpoch;
+        pending[0] = minFirst ? minEpoch : maxEpoch;
+        pending[1] = minFirst ? minError : maxError;
+        pending[2] = minFirst ? maxEpoch : minEpoch;
+        pending[3] = minFirst ? maxError : minError;
+    }
+
+    if(++pendingCount == bucketSize)
+    {
+        buckets << pending[0] << pending[1] << pending[2] << pending[3];
+        pendingCount = 0;
+        if(buckets.size() / 4 > maxBuckets)
+        {
+            mergeBuckets();
+        }
+    }
+}
+
+/**
+  * Merges adjacent buckets, halving their number and doubling the number
+  * of points each new bucket will cover.
+  */
+void MilestoneHistory::mergeBuckets()
+{
+    int count = buckets.size() / 4;
+    int out = 0;
+    for(int b = 0; b < count; b += 2, out++)
+    {
+        double *a = &buckets[4*b];
+        if(b + 1 == count)
+        {
+            for(int k = 0; k < 4; k++)
+                buckets[4*out + k] = a[k];
+            continue;
+        }
+        double *c = &buckets[4*(b+1)];
+
+        // lowest and highest of the four points
+        int lo = 0, hi = 0;
+        double points[8] = {a[0], a[1], a[2], a[3], c[0], c[1], c[2], c[3]};
+        for(int p = 1; p < 4; p++)
+        {
+            if(points[2*p+1] < points[2*lo+1]) lo = p;
+            if(points[2*p+1] > points[2*hi+1]) hi = p;
+        }
+        int first = qMin(lo, hi);
+        int second = qMax(lo, hi);
+        buckets[4*out] = points[2*first];
+        buckets[4*out + 1] = points[2*first+1];
+        buckets[4*out + 2] = points[2*second];
+        buckets[4*out + 3] = points[2*second+1];
+    }
+    buckets.resize(4*out);
+    bucketSize *= 2;
+}
+
+void MilestoneHistory::rebuild() const
+{
+    epochData.clear();
+    errorData.clear();
+    for(int b = 0; b < buckets.size(); b += 4)
+    {
+        epochData << buckets[b];
+        errorData << buckets[b+1];
+        if(buckets[b+2] != buckets[b])
+        {
+            epochData << buckets[b+2];
+            errorData << buckets[b+3];
+        }
+    }
+    if(pendingCount > 0)
+    {
+        epochData << pending[0];
+        errorData << pending[1];
+        if(pending[2] != pending[0])
+        {
+            epochData << pending[2];
+            errorData << pending[3];
+        }
+    }
+    for(int i = 0; i < recentCount; i++)
+    {
+        int slot = (recentStart + i) % recent;
+        epochData << recentEpochs[slot];
+        errorData << recentErrors[slot];
+    }
+    dirty = false;
+}
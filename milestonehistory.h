@@ -0,0 +1,60 @@
+#ifndef MILESTONEHISTORY_H
+#define MILESTONEHISTORY_H
+
+#include <QVector>
+#include <QString>
+#include <QFile>
+#include <QDataStream>
+
+/**
+  * Fixed-capacity (epoch, error) history of one network. The most recent
+  * points are kept at full resolution; older points are reduced to the
+  * minimum and maximum error of equal-sized buckets, and whenever the
+  * buckets run out of room adjacent pairs are merged and the bucket size
+  * doubles, so the resolution of old history degrades gradually instead of
+  * the history growing. Every point can optionally also be appended, at
+  * full resolution, to a spill file, which a later history can continue.
+  */
+class MilestoneHistory
+{
+public:
+    MilestoneHistory(int _capacity, QString spillFileName = QString(),
+                     bool continueSpill = false);
+    ~MilestoneHistory();
+
+    void append(double epoch, double error);
+    void restore(const QVector<double> &epochs, const QVector<double> &errors);
+    void clear();
+    bool isEmpty() const;
+    double lastEpoch() const;
+    const QVector<double> &epochs() const;
+    const QVector<double> &errors() const;
+    QString spillFileName() const;
+
+private:
+    int recent;
+    int maxBuckets;
+    int bucketSize;
+    // four values per bucket: epoch and error of its first and second
+    // extreme point, in epoch order
+    QVector<double> buckets;
+    double pending[4];
+    int pendingCount;
+    // ring of the last recent points; the oldest is at recentStart
+    QVector<double> recentEpochs;
+    QVector<double> recentErrors;
+    int recentStart;
+    int recentCount;
+    mutable QVector<double> epochData;
+    mutable QVector<double> errorData;
+    mutable bool dirty;
+    QFile spillFile;
+    QDataStream spill;
+
+    void add(double epoch, double error);
+    void age(double epoch, double error);
+    void mergeBuckets();
+    void rebuild() const;
+};
+
+#endif // MILESTONEHISTORY_H
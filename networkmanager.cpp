@@ -1,6 +1,5 @@
 #include <cmath>
 #include <vector>
-#include <map>
 #include <cstdlib>
 #include <ctime>
 #include <iostream>
@@ -11,19 +10,35 @@ using namespace std;
 #include <qwt_series_data.h>
 #include <qwt_legend.h>
 #include <qwt_plot_marker.h>
+#include <qwt_plot_intervalcurve.h>
 
 #include <QPen>
 #include <QBrush>
 #include <QColor>
 #include <QChar>
+#include <QDir>
+#include <QFile>
 
 #include "networkmanager.h"
 #include "ffnetwork.h"
 #include "config.h"
+#include "milestonehistory.h"
+#include "placement.h"
+#include "resultcache.h"
+#include "snapshotevaluator.h"
+#include "tracer.h"
+#include "telemetrywriter.h"
+#include "etasearch.h"
+#include "dataset.h"
 
 NetworkManager::NetworkManager(QwtPlot *_plot)
-    : numNetworks(0), averaged(0), networks(NULL), plot(_plot), curves(NULL),
-    minEpochMilestone(-1.0), isRunning(false)
+    : numNetworks(0), averaged(0), plot(_plot),
+    minEpochMilestone(-1.0), isRunning(false), dataset(NULL), newDataset(NULL),
+    pruneFraction(0.0), optimizer(Optimizer::Momentum), engine(FFNetwork::Backprop),
+    workers(1), parallelism(FFNetwork::Hogwild), historyCapacity(0), spillDirectory(),
+    priority(QThread::IdlePriority), band(ReplicaAggregate::MinMax), showReplicas(false),
+    cache(NULL), generation(0), evaluator(new SnapshotEvaluator), telemetry(NULL),
+    config(NULL), results(NULL)
 {
     legend = new QwtLegend;
     legend->setItemMode(QwtLegend::CheckableItem);
@@ -31,162 +46,609 @@ NetworkManager::NetworkManager(QwtPlot *_plot)
     plot->setCanvasBackground(QColor(255,255,255));
     connect(plot, SIGNAL(legendChecked(QwtPlotItem*, bool)),
             this, SLOT(legendChecked(QwtPlotItem*, bool)));
+    setDataset(new Dataset(Dataset::Parity, 4));
 }
 
-void NetworkManager::networksFromConfig(Config *c)
+/**
+  * Trains every network on the given dataset (which the manager then
+  * owns) from the next reconfiguration on.
+  */
+void NetworkManager::setDataset(Dataset *_dataset)
 {
     mutex.lock();
-    isRunning = false;
+    delete newDataset;
+    newDataset = _dataset;
+    mutex.unlock();
+}
 
-    // stop and delete existing networks
-    for(int i = 0; i < numNetworks; i++)
+/**
+  * Mean final epoch of the current networks that converged (0 if none
+  * did); converged is set to how many did.
+  */
+double NetworkManager::meanFinalEpoch(int &converged)
+{
+    quint64 epochs = 0;
+    converged = 0;
+    mutex.lock();
+    for(int n = 0; n < records.size(); n++)
     {
-        for(unsigned int a = 0; a < averaged; a++)
+        if(records[n].final == -1)
+            continue;
+        epochs += records[n].final;
+        converged++;
+    }
+    mutex.unlock();
+    return converged > 0 ? double(epochs) / converged : 0.0;
+}
+
+/**
+  * Epochs trained by the current networks so far, up to their final epoch
+  * for converged ones (cached results included).
+  */
+quint64 NetworkManager::trainedEpochs()
+{
+    quint64 epochs = 0;
+    mutex.lock();
+    for(int n = 0; n < records.size(); n++)
+    {
+        if(records[n].final != -1)
+            epochs += records[n].final;
+        else if(!records[n].history->isEmpty())
+            epochs += quint64(records[n].history->lastEpoch());
+    }
+    mutex.unlock();
+    return epochs;
+}
+
+/**
+  * The current networks, in record order; they are only valid until the
+  * next networksChanged().
+  */
+QVector<FFNetwork*> NetworkManager::getNetworks()
+{
+    QVector<FFNetwork*> networks;
+    mutex.lock();
+    for(int n = 0; n < records.size(); n++)
+        networks << records[n].network;
+    mutex.unlock();
+    return networks;
+}
+
+const Dataset *NetworkManager::getDataset() const
+{
+    return dataset;
+}
+
+/**
+  * The snapshot evaluator's latest clean error of network and the epoch of
+  * the snapshot it was measured on; false if there is none yet.
+  */
+bool NetworkManager::cleanError(FFNetwork *network, unsigned int &epoch, double &error)
+{
+    return evaluator->result(network, epoch, error);
+}
+
+NetworkManager::NetworkRecord &NetworkManager::record(int id, unsigned int avgId)
+{
+    return records[id*averaged + avgId];
+}
+
+/**
+  * Maps a (possibly stale) event to the network's current position; false
+  * if the sending network no longer exists. Ids only go stale for events
+  * queued before a reconfiguration moved or removed their network.
+  */
+bool NetworkManager::resolve(int &id, int &avgId)
+{
+    if(id < numNetworks && avgId < int(averaged) && record(id, avgId).network == sender())
+        return true;
+
+    for(int n = 0; n < records.size(); n++)
+    {
+        if(records[n].network == sender())
         {
-            networks[i][a]->quit();
-            networks[i][a]->wait();
-            disconnect(networks[i][a], SIGNAL(epochMilestone(int,int,int,double)),
-                       this, SLOT(epochMilestone(int,int,int,double)));
-            disconnect(networks[i][a], SIGNAL(epochFinal(int,int,int)),
-                       this, SLOT(epochFinal(int,int,int)));
-            delete networks[i][a];
-            delete epochMilestones[i][a];
-            delete errors[i][a];
-            if(markers[curves[i][a]] != NULL)
-            {
-                markers[curves[i][a]]->detach();
-                delete markers[curves[i][a]];
-            }
-            curves[i][a]->detach();
-            delete curves[i][a];
+            id = n / averaged;
+            avgId = n % averaged;
+            return true;
         }
+    }
+    return false;
+}
+
+static QString topologyName(const vector<unsigned int> &layers)
+{
+    QString name = QString::number(layers[0]);
+    for(unsigned int i = 1; i < layers.size(); i++)
+        name += QString("-%1").arg(layers[i]);
+    return name;
+}
 
-        delete[] networks[i];
-        delete[] epochMilestones[i];
-        delete[] errors[i];
-        delete[] curves[i];
-        delete[] finals[i];
+/**
+  * A history for replica avgId of the setting. If the replica's previous
+  * history spilled to previousSpill (closed by now), the new history
+  * continues that file, copied over if the spill directory changed.
+  */
+MilestoneHistory *NetworkManager::createHistory(const SettingRecord &setting, unsigned int avgId,
+                                                const QString &previousSpill)
+{
+    if(spillDirectory.isEmpty())
+        return new MilestoneHistory(historyCapacity);
+    QString name = QString("%1-eta%2-m%3-s%4-%5.bin").arg(topologyName(setting.layers))
+                   .arg(setting.eta, 0, 'f', 3).arg(setting.momentum, 0, 'f', 3)
+                   .arg(setting.stop, 0, 'f', 3).arg(avgId);
+    QString path = QDir(spillDirectory).filePath(name);
+    bool continueSpill = false;
+    if(!previousSpill.isEmpty())
+    {
+        if(previousSpill != path)
+        {
+            QFile::remove(path);
+            continueSpill = QFile::copy(previousSpill, path);
+        }
+        else
+        {
+            continueSpill = true;
+        }
     }
-    if(networks != NULL)
+    return new MilestoneHistory(historyCapacity, path, continueSpill);
+}
+
+/**
+  * Fills in the result of a network whose run is already in the cache, so
+  * it is never trained. Runs that are not reproducible are neither looked
+  * up nor stored.
+  */
+void NetworkManager::loadCached(NetworkRecord &rec)
+{
+    ResultCache::Entry entry;
+    if(cache == NULL || !rec.network->isReproducible()
+       || !cache->lookup(rec.network->signature(), entry))
+        return;
+
+    rec.network->setCachedResult(entry.final);
+    rec.final = entry.final;
+    for(int k = 0; k < entry.epochs.size(); k++)
+        rec.history->append(entry.epochs[k], entry.errors[k]);
+    rec.curve->setSamples(rec.history->epochs(), rec.history->errors());
+}
+
+/**
+  * Gives the network a new telemetry channel for its current run, or none
+  * if no telemetry file is set.
+  */
+void NetworkManager::openTelemetry(NetworkRecord &rec, const SettingRecord &setting,
+                                   unsigned int avgId)
+{
+    if(telemetry == NULL)
     {
-        delete[] networks;
-        delete[] epochMilestones;
-        delete[] errors;
-        delete[] curves;
-        delete[] finals;
-        legend->clear();
-        highlightedCurves.clear();
-        markers.clear();
-        networks = NULL;
+        rec.network->setTelemetry(NULL);
+        return;
     }
-    plot->replot();
+    rec.network->setTelemetry(telemetry->open(setting.layers, setting.eta, setting.momentum, avgId,
+                                              generation*0x10000 + avgId));
+}
 
-    vector<vector<double> > inputs;
-    vector<vector<double> > expected;
+/**
+  * Brings the networks in line with the config. Networks whose setting is
+  * still swept and whose training settings are unchanged are kept (with
+  * their progress); only removed networks are torn down, and new networks
+  * get no thread or buffers until resume() is first called. With a search
+  * budget, only the settings proposed by the searches are trained;
+  * unchanged searches carry on where they were.
+  */
+void NetworkManager::networksFromConfig(Config *c)
+{
+    int budget = c->getSearchBudget();
+    bool keepSearch = !searches.isEmpty() && budget > 0
+                      && searches[0]->sameRange(c->getEtaStart(), c->getEtaEnd(), budget)
+                      && isSameTraining(c) && averaged == c->getAveraged()
+                      && momenta == c->getMomenta() && stops == c->getStops()
+                      && hiddenLayers == c->getHiddenLayers();
+    if(!keepSearch)
+        createSearches(c);
+    config = c;
+    buildNetworks();
+    advanceSearch();
+}
 
-    // create inputs & expected values
-    for(int i = 0; i < 2; i++)
-        for(int j = 0; j < 2; j++)
-            for(int k = 0; k < 2; k++)
-                for(int l = 0; l < 2; l++)
-                {
-                    double a[4] = {i,j,k,l};
-                    vector<double> inputVec(a, a+4);
-                    double e[1] = {((i+j+k+l)%2 == 0) ? 0.0 : 1.0};
-                    vector<double> expectedVec(e, e+1);
-                    inputs.push_back(inputVec);
-                    expected.push_back(expectedVec);
-                }
+/**
+  * Starts one eta search per combination of the other swept values, or
+  * none without a search budget.
+  */
+void NetworkManager::createSearches(Config *c)
+{
+    for(int s = 0; s < searches.size(); s++)
+        delete searches[s];
+    searches.clear();
+    if(c->getSearchBudget() <= 0)
+        return;
+    int combinations = c->getHiddenLayers().size() * c->getStops().size()
+                       * c->getMomenta().size();
+    for(int s = 0; s < combinations; s++)
+        searches << new EtaSearch(c->getEtaStart(), c->getEtaEnd(), c->getSearchBudget());
+}
 
-    unsigned int l[3] = {4,4,1};
-    vector<unsigned int> layers(l, l+3);
+bool NetworkManager::isSearchFinished() const
+{
+    for(int s = 0; s < searches.size(); s++)
+    {
+        if(!searches[s]->isFinished())
+            return false;
+    }
+    return true;
+}
+
+/**
+  * Whether networks trained with the current settings would train the
+  * same under c.
+  */
+bool NetworkManager::isSameTraining(Config *c) const
+{
+    return !records.isEmpty() && newDataset == NULL
+           && pruneFraction == c->getPruneFraction()
+           && optimizer == c->getOptimizer()
+           && engine == c->getEngine()
+           && workers == c->getWorkers()
+           && (workers <= 1 || parallelism == c->getParallelism());
+}
+
+/**
+  * Creates, keeps or removes networks so there is one setting per
+  * combination of the swept values in the config, with the etas of the
+  * grid (or the searches).
+  */
+void NetworkManager::buildNetworks()
+{
+    Config *c = config;
+    mutex.lock();
+    isRunning = false;
 
     double etaStart = c->getEtaStart();
     double etaEnd = c->getEtaEnd();
     double etaIncrement = c->getEtaIncrement();
-    double momentum = c->getMomentum();
-    averaged = c->getAveraged();
-    double stop = c->getStop();
+    unsigned int newAveraged = c->getAveraged();
+    int reportInterval = c->getReportInterval();
+    unsigned int reportEpochCap = c->getReportEpochCap();
+    unsigned int stallWindow = c->getStallWindow();
+    double gradientFloor = c->getGradientFloor();
+    evaluator->setInterval(reportInterval);
+    Placement placement(c->getPlacement());
+
+    bool sameTraining = isSameTraining(c);
+    bool sameHistory = historyCapacity == c->getHistoryCapacity()
+                       && spillDirectory == c->getSpillDirectory();
 
-    if(etaEnd < 0.00001)
+    // the old dataset is deleted once its networks are
+    Dataset *oldDataset = NULL;
+    if(newDataset != NULL)
     {
-        numNetworks = 0;
-        mutex.unlock();
-        return;
+        oldDataset = dataset;
+        dataset = newDataset;
+        newDataset = NULL;
+        evaluator->setDataset(dataset->inputs(), dataset->expected());
     }
-    // determine number of networks
-    numNetworks = int(floor((etaEnd - etaStart)/etaIncrement)) + 1;
-    networks = new FFNetwork**[numNetworks];
-    finals = new int*[numNetworks];
-    epochMilestones = new QVector<double>**[numNetworks];
-    errors = new QVector<double>**[numNetworks];
-    curves = new QwtPlotCurve**[numNetworks];
-
-    // for each eta, create a network
-    double eta;
-    int i;
-    int r, g, b;
-    for(eta = etaStart, i = 0; i < numNetworks; eta += etaIncrement, i++)
-    {
-        r = qrand() % 256;
-        g = qrand() % 256;
-        b = qrand() % 256;
-
-        networks[i] = new FFNetwork*[averaged];
-        finals[i] = new int[averaged];
-        epochMilestones[i] = new QVector<double>*[averaged];
-        errors[i] = new QVector<double>*[averaged];
-        curves[i] = new QwtPlotCurve*[averaged];
 
-        for(unsigned int a = 0; a < averaged; a++)
+    momenta = c->getMomenta();
+    stops = c->getStops();
+    hiddenLayers = c->getHiddenLayers();
+    pruneFraction = c->getPruneFraction();
+    optimizer = c->getOptimizer();
+    engine = c->getEngine();
+    workers = c->getWorkers();
+    parallelism = c->getParallelism();
+    historyCapacity = c->getHistoryCapacity();
+    spillDirectory = c->getSpillDirectory();
+    priority = c->getPriority();
+    band = c->getBand();
+    showReplicas = c->getShowReplicas();
+
+    QString cacheFile = c->getCacheFile();
+    if(cache != NULL && cache->fileName() != cacheFile)
+    {
+        delete cache;
+        cache = NULL;
+    }
+    if(cache == NULL && !cacheFile.isEmpty())
+        cache = new ResultCache(cacheFile);
+
+    QString resultsFile = c->getResultsFile();
+    if(results != NULL && results->fileName() != resultsFile)
+    {
+        delete results;
+        results = NULL;
+    }
+    if(results == NULL && !resultsFile.isEmpty())
+    {
+        results = new QFile(resultsFile);
+        if(!results->open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+        {
+            cerr << "cannot write results to " << resultsFile.toAscii().data() << endl;
+            delete results;
+            results = NULL;
+        }
+        else if(results->size() == 0)
+        {
+            results->write("generation,topology,eta,momentum,stop,networks,converged,"
+                           "mean epochs,stddev epochs\n");
+            results->flush();
+        }
+    }
+
+    // a new telemetry file gets a new writer; the old one is only deleted
+    // once no network records to it any more
+    QString telemetryFile = c->getTelemetryFile();
+    TelemetryWriter *oldTelemetry = NULL;
+    bool newTelemetry = (telemetry == NULL) ? !telemetryFile.isEmpty()
+                                            : telemetry->fileName() != telemetryFile;
+    if(newTelemetry)
+    {
+        oldTelemetry = telemetry;
+        telemetry = NULL;
+        if(!telemetryFile.isEmpty())
+        {
+            telemetry = new TelemetryWriter(telemetryFile);
+            telemetry->start(QThread::LowPriority);
+        }
+    }
+
+    QVector<double> grid;
+    if(etaEnd >= 0.00001)
+    {
+        int count = int(floor((etaEnd - etaStart)/etaIncrement)) + 1;
+        double eta = etaStart;
+        for(int i = 0; i < count; i++, eta += etaIncrement)
+            grid << eta;
+    }
+
+    // determine the settings: every combination of topology, stop and
+    // momentum with each eta of the grid or of its search. The topology is
+    // outermost, so networks of the same size are created, and placed,
+    // next to each other
+    QVector<SettingRecord> wanted;
+    for(int t = 0; t < hiddenLayers.size(); t++)
+    {
+        vector<unsigned int> layers = dataset->topology(hiddenLayers[t]);
+        for(int s = 0; s < stops.size(); s++)
+        {
+            for(int m = 0; m < momenta.size(); m++)
+            {
+                int combination = (t*stops.size() + s)*momenta.size() + m;
+                QVector<double> etas = searches.isEmpty() ? grid
+                                                          : searches[combination]->points();
+                for(int p = 0; p < etas.size(); p++)
+                {
+                    SettingRecord setting;
+                    setting.eta = etas[p];
+                    setting.momentum = momenta[m];
+                    setting.stop = stops[s];
+                    setting.layers = layers;
+                    setting.search = searches.isEmpty() ? -1 : combination;
+                    setting.point = p;
+                    wanted << setting;
+                }
+            }
+        }
+    }
+    int newNumNetworks = wanted.size();
+
+    QVector<NetworkRecord> newRecords(newNumNetworks * newAveraged);
+    QVector<SettingRecord> newSettings(newNumNetworks);
+    QVector<bool> kept(records.size(), false);
+
+    // for each setting, find or create its networks
+    for(int i = 0; i < newNumNetworks; i++)
+    {
+        double eta = wanted[i].eta;
+        int old = -1;
+        if(sameTraining)
+        {
+            for(int o = 0; o < settings.size(); o++)
+            {
+                // (a setting already taken has no curve any more)
+                if(settings[o].meanCurve != NULL && fabs(settings[o].eta - eta) < 1e-9
+                   && settings[o].momentum == wanted[i].momentum
+                   && settings[o].stop == wanted[i].stop
+                   && settings[o].layers == wanted[i].layers)
+                {
+                    old = o;
+                    break;
+                }
+            }
+        }
+
+        SettingRecord &setting = newSettings[i];
+        if(old >= 0)
         {
-            networks[i][a] = new FFNetwork(i, a, layers, eta, momentum, stop, inputs, expected);
-            finals[i][a] = -1;
-            connect(networks[i][a], SIGNAL(epochMilestone(int,int,int,double)),
-                    this, SLOT(epochMilestone(int,int,int,double)));
-            connect(networks[i][a], SIGNAL(epochFinal(int,int,int)),
-                    this, SLOT(epochFinal(int,int,int)));
-            networks[i][a]->start(QThread::IdlePriority);
-            epochMilestones[i][a] = new QVector<double>;
-            errors[i][a] = new QVector<double>;
-            curves[i][a] = new QwtPlotCurve;
-            curves[i][a]->setPen(QPen(QBrush(QColor(r,g,b)), 2.0));
-            curves[i][a]->setRenderHint(QwtPlotCurve::RenderAntialiased, true);
-            curves[i][a]->attach(plot);
-            if(a == 0)
+            setting = settings[old];
+            settings[old].marker = NULL;
+            settings[old].meanCurve = NULL;
+            settings[old].bandCurve = NULL;
+            setting.meanCurve->setId(i);
+            setting.search = wanted[i].search;
+            setting.point = wanted[i].point;
+        }
+        else
+        {
+            setting = wanted[i];
+            setting.written = false;
+            setting.color = QColor(qrand() % 256, qrand() % 256, qrand() % 256);
+            setting.marker = NULL;
+            setting.highlighted = false;
+            setting.meanCurve = new NetworkCurve(i);
+            QString title = (QString(QChar(0x03B7))+QString(" = %1, ")+
+                             QString(QChar(0x03B1))+QString(" = %2"))
+                            .arg(eta, 3, 'f', 2)
+                            .arg(setting.momentum, 3, 'f', 2);
+            if(stops.size() > 1)
+                title += QString(", stop %1").arg(setting.stop);
+            if(hiddenLayers.size() > 1)
+                title += QString(", ") + topologyName(setting.layers);
+            setting.meanCurve->setTitle(title);
+            setting.meanCurve->setPen(QPen(QBrush(setting.color), 2.0));
+            setting.meanCurve->setRenderHint(QwtPlotCurve::RenderAntialiased, true);
+            setting.meanCurve->attach(plot);
+            QColor bandColor = setting.color;
+            bandColor.setAlpha(48);
+            setting.bandCurve = new QwtPlotIntervalCurve;
+            setting.bandCurve->setItemAttribute(QwtPlotItem::Legend, false);
+            setting.bandCurve->setPen(QPen(Qt::NoPen));
+            setting.bandCurve->setBrush(QBrush(bandColor));
+            setting.bandCurve->attach(plot);
+        }
+        // rebuilt from the histories once all the networks are in place
+        setting.aggregate = new ReplicaAggregate(newAveraged, historyCapacity, band);
+
+        for(unsigned int a = 0; a < newAveraged; a++)
+        {
+            NetworkRecord &rec = newRecords[i*newAveraged + a];
+            if(old >= 0 && a < averaged)
             {
-                curves[i][a]->setTitle((QString(QChar(0x03B7))+QString(" = %1, ")+
-                                     QString(QChar(0x03B1))+QString(" = %2"))
-                                    .arg(eta, 3, 'f', 2)
-                                    .arg(momentum, 3, 'f', 2));
+                rec = record(old, a);
+                kept[old*averaged + a] = true;
+                rec.network->pause();
+                rec.network->setId(i);
+                rec.curve->setId(i);
+                if(newTelemetry)
+                    openTelemetry(rec, setting, a);
+                if(!sameHistory)
+                {
+                    // the old history has to close its spill file before
+                    // the new one opens it
+                    QVector<double> epochs = rec.history->epochs();
+                    QVector<double> errors = rec.history->errors();
+                    QString previousSpill = rec.history->spillFileName();
+                    delete rec.history;
+                    rec.history = createHistory(setting, a, previousSpill);
+                    rec.history->restore(epochs, errors);
+                }
             }
             else
             {
-                legend->remove(curves[i][a]);
+                rec.network = new FFNetwork(i, a, setting.layers, eta, setting.momentum,
+                                            setting.stop, optimizer, dataset);
+                rec.network->setPruneFraction(pruneFraction);
+                rec.network->setEngine(engine);
+                // the seed only depends on the replica, so every setting
+                // with the same topology starts replica a from the same
+                // initial weights
+                rec.network->setSeed(generation*0x10000 + a);
+                openTelemetry(rec, setting, a);
+                rec.final = -1;
+                connect(rec.network, SIGNAL(epochMilestone(int,int,int,double)),
+                        this, SLOT(epochMilestone(int,int,int,double)));
+                connect(rec.network, SIGNAL(epochFinal(int,int,int)),
+                        this, SLOT(epochFinal(int,int,int)));
+                connect(rec.network, SIGNAL(epochFailed(int,int,int,int)),
+                        this, SLOT(epochFailed(int,int,int,int)));
+                evaluator->add(rec.network);
+                rec.history = createHistory(setting, a);
+                rec.curve = new NetworkCurve(i);
+                rec.curve->setItemAttribute(QwtPlotItem::Legend, false);
+                rec.curve->setPen(QPen(QBrush(setting.color), 1.0));
+                rec.curve->setRenderHint(QwtPlotCurve::RenderAntialiased, true);
+                rec.curve->attach(plot);
+                loadCached(rec);
             }
-            highlightedCurves[curves[i][a]] = false;
-            markers[curves[i][a]] = NULL;
+            rec.network->setReporting(reportInterval, reportEpochCap);
+            rec.network->setHealthChecks(stallWindow, gradientFloor);
+            rec.network->setParallelism(parallelism, workers);
+            // each network gets one CPU per worker
+            unsigned int first = (i*newAveraged + a) * workers;
+            QVector<int> workerCpus;
+            for(unsigned int w = 0; w < workers; w++)
+                workerCpus << placement.cpuFor(first + w);
+            rec.network->setPlacement(workerCpus[0], workerCpus);
+        }
+    }
+
+    // stop removed networks; all of them are told to quit before waiting
+    // on any, so their threads wind down in parallel
+    for(int n = 0; n < records.size(); n++)
+    {
+        if(!kept[n])
+            records[n].network->quit();
+    }
+    for(int n = 0; n < records.size(); n++)
+    {
+        if(kept[n]) continue;
+        records[n].network->wait();
+        evaluator->remove(records[n].network);
+        disconnect(records[n].network, SIGNAL(epochMilestone(int,int,int,double)),
+                   this, SLOT(epochMilestone(int,int,int,double)));
+        disconnect(records[n].network, SIGNAL(epochFinal(int,int,int)),
+                   this, SLOT(epochFinal(int,int,int)));
+        disconnect(records[n].network, SIGNAL(epochFailed(int,int,int,int)),
+                   this, SLOT(epochFailed(int,int,int,int)));
+        delete records[n].network;
+        delete records[n].history;
+        records[n].curve->detach();
+        delete records[n].curve;
+    }
+    for(int o = 0; o < settings.size(); o++)
+    {
+        if(settings[o].marker != NULL)
+        {
+            settings[o].marker->detach();
+            delete settings[o].marker;
         }
+        if(settings[o].meanCurve != NULL)
+        {
+            settings[o].meanCurve->detach();
+            delete settings[o].meanCurve;
+            settings[o].bandCurve->detach();
+            delete settings[o].bandCurve;
+        }
+        delete settings[o].aggregate;
+    }
+    delete oldTelemetry;
+    delete oldDataset;
+
+    records = newRecords;
+    settings = newSettings;
+    numNetworks = newNumNetworks;
+    averaged = newAveraged;
+    for(int n = 0; n < numNetworks; n++)
+    {
+        rebuildAggregate(n);
+        updateReplicas(n);
     }
+    plot->replot();
     mutex.unlock();
+    emit networksChanged();
+
+    // settings whose networks all came from the cache are done already
+    for(int n = 0; n < numNetworks; n++)
+        writeResult(n);
 }
 
 void NetworkManager::epochMilestone(int id, int avgId, int epoch, double error)
 {
+    TraceSpan span("milestone delivery", id, avgId, epoch);
+    qint64 traceStart = Tracer::isEnabled() ? Tracer::now() : 0;
     mutex.lock();
+    Tracer::complete("manager lock wait", traceStart);
+    if(!resolve(id, avgId))
+    {
+        mutex.unlock();
+        return;
+    }
 
-    *epochMilestones[id][avgId] << double(epoch);
-    *errors[id][avgId] << error;
-    curves[id][avgId]->setSamples(*epochMilestones[id][avgId], *errors[id][avgId]);
+    NetworkRecord &rec = record(id, avgId);
+    rec.history->append(double(epoch), error);
+    if(rec.curve->isVisible())
+        rec.curve->setSamples(rec.history->epochs(), rec.history->errors());
+    settings[id].aggregate->update(avgId, double(epoch), error);
+    updateAggregate(id);
 
     // find mean and stddev for the finals in this network configuration
     // then stop this network (id,avgId) if it's way beyond the finals mean
+    NetworkRecord *setting = &records[id*averaged];
     int avgFinalEpoch = 0;
     int count = 0;
     for(unsigned int a = 0; a < averaged; a++)
     {
-        if(finals[id][a] == -1) continue;
-        avgFinalEpoch += finals[id][a];
+        if(setting[a].final == -1) continue;
+        avgFinalEpoch += setting[a].final;
         count++;
     }
     if(count != 0)
@@ -195,37 +657,37 @@ void NetworkManager::epochMilestone(int id, int avgId, int epoch, double error)
         double stddevsum = 0.0;
         for(unsigned int a = 0; a < averaged; a++)
         {
-            if(finals[id][a] == -1) continue;
-            stddevsum += pow(avgFinalEpoch - finals[id][a], 2.0);
+            if(setting[a].final == -1) continue;
+            stddevsum += pow(avgFinalEpoch - setting[a].final, 2.0);
         }
         double stddev = sqrt(stddevsum / count);
         if(stddev > 0.0 && epoch > 3*stddev + avgFinalEpoch)
         {
-            networks[id][avgId]->cancel();
+            rec.network->cancel();
+            writeResult(id);
+            // that may have finished the setting; checked once the mutex
+            // is free
+            if(!searches.isEmpty())
+                QMetaObject::invokeMethod(this, "advanceSearch", Qt::QueuedConnection);
         }
     }
 
-    // continually remove the legend item
-    // (legend seems to update and add the item when curve is updated)
-    if(avgId != 0)
-        legend->remove(curves[id][avgId]);
-
     plot->replot();
 
     if(isRunning)
     {
         bool someRunning = false;
-        for(int i = 0; i < numNetworks; i++)
+        for(int n = 0; n < records.size(); n++)
         {
-            for(unsigned int a = 0; a < averaged; a++)
+            if(!isNetworkDone(n))
             {
-                if(!networks[i][a]->isSuccessful())
-                {
-                    someRunning = true;
-                }
+                someRunning = true;
+                break;
             }
         }
-        if(!someRunning)
+        // a search that is not finished yet goes on once this network's
+        // result is in
+        if(!someRunning && isSearchFinished())
         {
             isRunning = false;
             emit stopped();
@@ -239,28 +701,22 @@ void NetworkManager::epochMilestone(int id, int avgId, int epoch, double error)
         else
         {
             double newMinEpochMilestone = double(epoch);
-            for(int i = 0; i < numNetworks; i++)
+            for(int n = 0; n < records.size(); n++)
             {
-                for(unsigned int a = 0; a < averaged; a++)
-                {
-                    if(networks[i][a]->isSuccessful()) continue;
-                    if(epochMilestones[i][a]->isEmpty()) continue;
-                    if(epochMilestones[i][a]->last() < newMinEpochMilestone)
-                        newMinEpochMilestone = epochMilestones[i][a]->last();
-                }
+                if(records[n].network->isSuccessful()) continue;
+                if(records[n].history->isEmpty()) continue;
+                if(records[n].history->lastEpoch() < newMinEpochMilestone)
+                    newMinEpochMilestone = records[n].history->lastEpoch();
             }
             minEpochMilestone = newMinEpochMilestone;
-            for(int i = 0; i < numNetworks; i++)
+            for(int n = 0; n < records.size(); n++)
             {
-                for(unsigned int a = 0; a < averaged; a++)
-                {
-                    if(networks[i][a]->isSuccessful()) continue;
-                    if(!epochMilestones[i][a]->isEmpty()
-                        && epochMilestones[i][a]->last() > minEpochMilestone)
-                        networks[i][a]->pause();
-                    else
-                        networks[i][a]->resume();
-                }
+                if(records[n].network->isSuccessful()) continue;
+                if(!records[n].history->isEmpty()
+                    && records[n].history->lastEpoch() > minEpochMilestone)
+                    records[n].network->pause();
+                else
+                    records[n].network->resume();
             }
         }
     }
@@ -269,45 +725,264 @@ void NetworkManager::epochMilestone(int id, int avgId, int epoch, double error)
 
 void NetworkManager::epochFinal(int id, int avgId, int epoch)
 {
-    finals[id][avgId] = epoch;
-    // determine if this network has completely finished
-    bool done = true;
-    for(unsigned int a = 0; a < averaged; a++)
+    if(!resolve(id, avgId))
+        return;
+    NetworkRecord &rec = record(id, avgId);
+    rec.final = epoch;
+    if(cache != NULL && rec.network->isReproducible())
     {
-        done &= (finals[id][a] != -1);
+        ResultCache::Entry entry;
+        entry.final = epoch;
+        entry.epochs = rec.history->epochs();
+        entry.errors = rec.history->errors();
+        cache->store(rec.network->signature(), entry);
     }
-    if(done && highlightedCurves[curves[id][0]])
+    // the other networks of the setting may have failed instead
+    if(isSettingDone(id) && settings[id].highlighted)
     {
         updateMarker(id);
     }
+    writeResult(id);
+    // the last network to finish stops the manager
+    if(!searches.isEmpty())
+        advanceSearch();
+    else
+        checkStopped();
 }
 
-void NetworkManager::resume()
+/**
+  * A network diverged or stalled and stopped training. It has no final
+  * epoch, so like a canceled network it is left out of the setting's
+  * statistics, and its result is not cached.
+  */
+void NetworkManager::epochFailed(int id, int avgId, int epoch, int status)
 {
-    mutex.lock();
-    isRunning = true;
+    if(!resolve(id, avgId))
+        return;
+    NetworkRecord &rec = record(id, avgId);
+    cout << (QString("%1 - %2 at epoch %3").arg(rec.network->toString())
+             .arg(status == FFNetwork::Diverged ? QString("diverged") : QString("stalled"))
+             .arg(epoch).toAscii().data()) << endl;
+
+    if(isSettingDone(id) && settings[id].highlighted)
+    {
+        updateMarker(id);
+    }
+    writeResult(id);
+    if(!searches.isEmpty())
+        advanceSearch();
+    else
+        checkStopped();
+}
+
+/**
+  * Feeds the settings that have finished to their searches and creates the
+  * settings they propose next, resuming training if it was running.
+  * Reports the best setting of each search once its whole budget has been
+  * trained.
+  */
+void NetworkManager::advanceSearch()
+{
+    if(searches.isEmpty())
+        return;
+
+    bool wasRunning = isRunning;
+    QVector<bool> wasFinished(searches.size());
+    for(int s = 0; s < searches.size(); s++)
+        wasFinished[s] = searches[s]->isFinished();
+    bool rebuilt = false;
+    forever
+    {
+        bool proposed = false;
+        for(int i = 0; i < numNetworks; i++)
+        {
+            EtaSearch *search = searches[settings[i].search];
+            if(search->isReported(settings[i].point) || !isSettingDone(i))
+                continue;
+            int count = search->count();
+            search->report(settings[i].point, settingCost(i));
+            proposed |= search->count() != count;
+        }
+        if(!proposed)
+            break;
+        buildNetworks();
+        rebuilt = true;
+    }
+
     for(int i = 0; i < numNetworks; i++)
     {
-        for(unsigned int a = 0; a < averaged; a++)
+        EtaSearch *search = searches[settings[i].search];
+        if(wasFinished[settings[i].search] || !search->isFinished()
+           || search->best() != settings[i].point)
+            continue;
+        if(search->cost(settings[i].point) < HUGE_VAL)
+        {
+            cout << (QString("%1 - best of %2 searched settings, %3 epochs per converged network")
+                     .arg(record(i, 0).network->toString()).arg(search->count())
+                     .arg(int(search->cost(settings[i].point))).toAscii().data()) << endl;
+        }
+        else
+        {
+            cout << (QString("%1 - no network converged in %2 searched settings")
+                     .arg(record(i, 0).network->toString())
+                     .arg(search->count()).toAscii().data()) << endl;
+        }
+        updateMarker(i);
+    }
+
+    if(rebuilt && wasRunning)
+        resume();
+    else
+        checkStopped();
+}
+
+/**
+  * True once network n is done (converged, failed, canceled or loaded from
+  * the cache) and its result is in: a network that converged stops before
+  * its final epoch reaches epochFinal().
+  */
+bool NetworkManager::isNetworkDone(int n)
+{
+    FFNetwork *network = records[n].network;
+    return network->isSuccessful()
+           && (records[n].final != -1 || network->getStatus() != FFNetwork::Converged);
+}
+
+/**
+  * True once every network of the setting is done.
+  */
+bool NetworkManager::isSettingDone(int id)
+{
+    for(unsigned int a = 0; a < averaged; a++)
+    {
+        if(!isNetworkDone(id*averaged + a))
+            return false;
+    }
+    return true;
+}
+
+/**
+  * Cost of a finished setting for the search: the mean final epoch of its
+  * networks that converged, scaled by averaged/converged, HUGE_VAL if none
+  * did. The cost rises with the share of networks that failed, but not
+  * with how long they ran before failing, which the health checks decide
+  * more than eta does.
+  */
+double NetworkManager::settingCost(int id)
+{
+    double epochs = 0.0;
+    int converged = 0;
+    for(unsigned int a = 0; a < averaged; a++)
+    {
+        NetworkRecord &rec = record(id, a);
+        if(rec.final != -1)
         {
-            networks[i][a]->resume();
-            if(markers[curves[i][a]] != NULL)
-                markers[curves[i][a]]->show();
+            epochs += rec.final;
+            converged++;
         }
     }
+    if(converged == 0)
+        return HUGE_VAL;
+    return (epochs / converged) * (double(averaged) / converged);
+}
+
+/**
+  * Appends a finished setting to the results file (once): the networks
+  * that converged and the mean and standard deviation of their final
+  * epochs.
+  */
+void NetworkManager::writeResult(int id)
+{
+    SettingRecord &setting = settings[id];
+    if(results == NULL || setting.written || !isSettingDone(id))
+        return;
+
+    double sum = 0.0;
+    int converged = 0;
+    for(unsigned int a = 0; a < averaged; a++)
+    {
+        if(record(id, a).final == -1) continue;
+        sum += record(id, a).final;
+        converged++;
+    }
+    double mean = converged > 0 ? sum / converged : 0.0;
+    double squares = 0.0;
+    for(unsigned int a = 0; a < averaged; a++)
+    {
+        if(record(id, a).final == -1) continue;
+        squares += pow(record(id, a).final - mean, 2.0);
+    }
+    double stddev = converged > 0 ? sqrt(squares / converged) : 0.0;
+
+    QString line = QString("%1,%2,%3,%4,%5,%6,%7,%8,%9\n").arg(generation)
+                   .arg(topologyName(setting.layers)).arg(setting.eta).arg(setting.momentum)
+                   .arg(setting.stop).arg(averaged).arg(converged)
+                   .arg(converged > 0 ? QString::number(mean, 'f', 1) : QString())
+                   .arg(converged > 0 ? QString::number(stddev, 'f', 1) : QString());
+    results->write(line.toAscii());
+    results->flush();
+    setting.written = true;
+}
+
+/**
+  * Emits stopped() if training is on but no network (and no search step)
+  * is left to train.
+  */
+void NetworkManager::checkStopped()
+{
+    mutex.lock();
+    bool stop = isRunning && isSearchFinished();
+    for(int n = 0; stop && n < records.size(); n++)
+    {
+        if(!isNetworkDone(n))
+            stop = false;
+    }
+    if(stop)
+        isRunning = false;
     mutex.unlock();
+
+    if(stop)
+        emit stopped();
+}
+
+void NetworkManager::resume()
+{
+    mutex.lock();
+    isRunning = true;
+    if(!evaluator->isRunning())
+        evaluator->start(QThread::LowestPriority);
+    bool someRunning = false;
+    for(int n = 0; n < records.size(); n++)
+    {
+        // networks whose result came from the cache are never started
+        if(records[n].network->isSuccessful())
+            continue;
+        someRunning = true;
+        // threads are started lazily, on the first resume
+        if(!records[n].network->isRunning())
+            records[n].network->start(priority);
+        records[n].network->resume();
+    }
+    for(int i = 0; i < settings.size(); i++)
+    {
+        if(settings[i].marker != NULL)
+            settings[i].marker->show();
+    }
+    if(!someRunning)
+        isRunning = false;
+    mutex.unlock();
+
+    if(!someRunning)
+        emit stopped();
 }
 
 void NetworkManager::pause()
 {
     mutex.lock();
     isRunning = false;
-    for(int i = 0; i < numNetworks; i++)
+    for(int n = 0; n < records.size(); n++)
     {
-        for(unsigned int a = 0; a < averaged; a++)
-        {
-            networks[i][a]->pause();
-        }
+        records[n].network->pause();
     }
     mutex.unlock();
 }
@@ -316,50 +991,59 @@ void NetworkManager::restart()
 {
     mutex.lock();
     isRunning = false;
+    generation++;
     for(int i = 0; i < numNetworks; i++)
     {
         for(unsigned int a = 0; a < averaged; a++)
         {
-            networks[i][a]->restart();
-            finals[i][a] = -1;
-            epochMilestones[i][a]->clear();
-            errors[i][a]->clear();
-            curves[i][a]->setSamples(*epochMilestones[i][a], *errors[i][a]);
-            // continually remove the legend item
-            // (legend seems to update and add the item when curve is updated)
-            if(a != 0)
-                legend->remove(curves[i][a]);
+            NetworkRecord &rec = record(i, a);
+            rec.network->setSeed(generation*0x10000 + a);
+            rec.network->restart();
+            openTelemetry(rec, settings[i], a);
+            rec.final = -1;
+            rec.history->clear();
+            loadCached(rec);
+            rec.curve->setSamples(rec.history->epochs(), rec.history->errors());
         }
-        if(markers[curves[i][0]] != NULL)
+        if(settings[i].marker != NULL)
         {
-            markers[curves[i][0]]->detach();
-            delete markers[curves[i][0]];
-            markers[curves[i][0]] = NULL;
+            settings[i].marker->detach();
+            delete settings[i].marker;
+            settings[i].marker = NULL;
         }
-        highlightedCurves[curves[i][0]] = false;
+        settings[i].highlighted = false;
+        settings[i].written = false;
+        rebuildAggregate(i);
+        updateReplicas(i);
     }
     plot->replot();
     mutex.unlock();
+
+    for(int i = 0; i < numNetworks; i++)
+        writeResult(i);
+
+    if(!searches.isEmpty())
+    {
+        // the new generation searches from scratch
+        createSearches(config);
+        buildNetworks();
+        advanceSearch();
+    }
 }
 
 void NetworkManager::legendChecked(QwtPlotItem *item, bool on)
 {
-    QwtPlotCurve *curve = dynamic_cast<QwtPlotCurve*>(item);
-    // determine id
-    int id;
-    for(id = 0; id < numNetworks; id++)
-    {
-        if(curves[id][0] == curve) break;
-    }
-    if(id == numNetworks) return; // shouldn't happen
+    NetworkCurve *curve = dynamic_cast<NetworkCurve*>(item);
+    if(curve == NULL) return; // shouldn't happen
+    int id = curve->getId();
 
     bool networkSuccessful = true;
     for(unsigned int a = 0; a < averaged; a++)
     {
-        networkSuccessful &= networks[id][a]->isSuccessful();
+        networkSuccessful &= record(id, a).network->isSuccessful();
     }
 
-    highlightedCurves[curve] = on;
+    settings[id].highlighted = on;
     QPen pen = curve->pen();
     if(on)
     {
@@ -372,47 +1056,103 @@ void NetworkManager::legendChecked(QwtPlotItem *item, bool on)
     else
     {
         pen.setWidth(2);
-        if(markers[curves[id][0]] != NULL)
+        if(settings[id].marker != NULL)
         {
-            markers[curves[id][0]]->detach();
-            delete markers[curves[id][0]];
-            markers[curves[id][0]] = NULL;
+            settings[id].marker->detach();
+            delete settings[id].marker;
+            settings[id].marker = NULL;
         }
     }
+    curve->setPen(pen);
+    updateReplicas(id);
+    plot->replot();
+}
+
+/**
+  * Recomputes a setting's mean and band from its networks' histories.
+  */
+void NetworkManager::rebuildAggregate(int id)
+{
+    QVector<MilestoneHistory*> histories;
     for(unsigned int a = 0; a < averaged; a++)
+        histories << record(id, a).history;
+    settings[id].aggregate->rebuild(histories);
+    updateAggregate(id);
+}
+
+void NetworkManager::updateAggregate(int id)
+{
+    SettingRecord &setting = settings[id];
+    const ReplicaAggregate *aggregate = setting.aggregate;
+    QVector<QwtIntervalSample> intervals(aggregate->epochs().size());
+    for(int p = 0; p < intervals.size(); p++)
     {
-        curves[id][a]->setPen(pen);
+        intervals[p] = QwtIntervalSample(aggregate->epochs()[p],
+                                         aggregate->lower()[p], aggregate->upper()[p]);
+    }
+    setting.meanCurve->setSamples(aggregate->epochs(), aggregate->means());
+    setting.bandCurve->setSamples(intervals);
+}
 
-        // continually remove the legend item
-        // (legend seems to update and add the item when curve is updated)
-        if(a != 0)
-            legend->remove(curves[id][a]);
+/**
+  * Shows a setting's network curves if every network is drawn or the
+  * setting is highlighted, and hides them otherwise. Hidden curves are not
+  * kept up to date, so they are refreshed when they are shown again.
+  */
+void NetworkManager::updateReplicas(int id)
+{
+    bool shown = showReplicas || settings[id].highlighted;
+    for(unsigned int a = 0; a < averaged; a++)
+    {
+        NetworkRecord &rec = record(id, a);
+        if(shown && !rec.curve->isVisible())
+            rec.curve->setSamples(rec.history->epochs(), rec.history->errors());
+        rec.curve->setVisible(shown);
     }
-    plot->replot();
 }
 
 void NetworkManager::updateMarker(int id)
 {
-    if(markers[curves[id][0]] == NULL)
+    if(settings[id].marker == NULL)
     {
-        markers[curves[id][0]] = new QwtPlotMarker;
-        markers[curves[id][0]]->setRenderHint(QwtPlotItem::RenderAntialiased, true);
+        settings[id].marker = new QwtPlotMarker;
+        settings[id].marker->setRenderHint(QwtPlotItem::RenderAntialiased, true);
     }
+    QwtPlotMarker *marker = settings[id].marker;
+    NetworkRecord *setting = &records[id*averaged];
 
     int avgEpochs = 0;
     int count = 0;
     for(unsigned int a = 0; a < averaged; a++)
     {
-        if(finals[id][a] == -1) continue; // may be true if a network was "canceled"
-        avgEpochs += finals[id][a];
+        if(setting[a].final == -1) continue; // may be true if a network was "canceled"
+        avgEpochs += setting[a].final;
         count++;
     }
+    if(count == 0)
+    {
+        // every network diverged, stalled or was canceled
+        double lastEpoch = 0.0;
+        for(unsigned int a = 0; a < averaged; a++)
+        {
+            if(!setting[a].history->isEmpty())
+                lastEpoch = qMax(lastEpoch, setting[a].history->lastEpoch());
+        }
+        marker->setXValue(lastEpoch);
+        marker->setYValue(0.1);
+        marker->setLabel(QwtText(QString("no network converged")));
+        cout << (QString("%1 - no network converged").arg(setting[0].network->toString())
+                 .toAscii().data()) << endl;
+        marker->attach(plot);
+        plot->replot();
+        return;
+    }
     avgEpochs /= count;
     double stddevsum = 0.0;
     for(unsigned int a = 0; a < averaged; a++)
     {
-        if(finals[id][a] == -1) continue;
-        stddevsum += pow((double(finals[id][a]) - double(avgEpochs)), 2.0);
+        if(setting[a].final == -1) continue;
+        stddevsum += pow((double(setting[a].final) - double(avgEpochs)), 2.0);
     }
     double stddev = sqrt(stddevsum / double(count));
 
@@ -421,40 +1161,57 @@ void NetworkManager::updateMarker(int id)
     count = 0;
     for(unsigned int a = 0; a < averaged; a++)
     {
-        if(stddev > 0.0 && double(finals[id][a]) > 2*stddev+avgEpochs) continue;
-        avgEpochs2 += finals[id][a];
+        if(setting[a].final == -1) continue;
+        if(stddev > 0.0 && double(setting[a].final) > 2*stddev+avgEpochs) continue;
+        avgEpochs2 += setting[a].final;
         count++;
     }
     avgEpochs2 /= count;
     double stddevsum2 = 0.0;
     for(unsigned int a = 0; a < averaged; a++)
     {
-        if(stddev > 0.0 && double(finals[id][a]) > 2*stddev+avgEpochs) continue;
-        stddevsum2 += pow((double(finals[id][a]) - double(avgEpochs2)), 2.0);
+        if(setting[a].final == -1) continue;
+        if(stddev > 0.0 && double(setting[a].final) > 2*stddev+avgEpochs) continue;
+        stddevsum2 += pow((double(setting[a].final) - double(avgEpochs2)), 2.0);
     }
     double stddev2 = sqrt(stddevsum2 / double(count));
 
-    markers[curves[id][0]]->setXValue(avgEpochs2);
-    markers[curves[id][0]]->setYValue(0.1);
+    marker->setXValue(avgEpochs2);
+    marker->setYValue(0.1);
     if(avgEpochs != avgEpochs2)
     {
         QString text = QString(QChar(0x03BC))+QString("=%1/%2, ")
                        .arg(avgEpochs).arg(avgEpochs2) +
                        QString(QChar(0x03C3))+QString("=%1/%2")
                        .arg(int(stddev)).arg(int(stddev2));
-        markers[curves[id][0]]->setLabel(QwtText(text));
-        cout << (QString("%1 - %2").arg(networks[id][0]->toString())
+        marker->setLabel(QwtText(text));
+        cout << (QString("%1 - %2").arg(setting[0].network->toString())
                  .arg(text).toAscii().data()) << endl;
     }
     else
     {
         QString text = QString(QChar(0x03BC))+QString("=%1, ").arg(avgEpochs) +
                        QString(QChar(0x03C3))+QString("=%1").arg(int(stddev));
-        markers[curves[id][0]]->setLabel(QwtText(text));
-        cout << (QString("%1 - %2").arg(networks[id][0]->toString())
+        marker->setLabel(QwtText(text));
+        cout << (QString("%1 - %2").arg(setting[0].network->toString())
                  .arg(text).toAscii().data()) << endl;
     }
 
-    markers[curves[id][0]]->attach(plot);
+    unsigned int cleanEpoch;
+    double cleanError;
+    if(evaluator->result(setting[0].network, cleanEpoch, cleanError))
+    {
+        cout << (QString("%1 - clean error %2 at epoch %3").arg(setting[0].network->toString())
+                 .arg(cleanError).arg(cleanEpoch).toAscii().data()) << endl;
+    }
+
+    QString quantization = setting[0].network->quantizationReport();
+    if(!quantization.isEmpty())
+    {
+        cout << (QString("%1 - %2").arg(setting[0].network->toString())
+                 .arg(quantization).toAscii().data()) << endl;
+    }
+
+    marker->attach(plot);
     plot->replot();
 }
@@ -1,19 +1,48 @@
 #ifndef NETWORKMANAGER_H
 #define NETWORKMANAGER_H
 
-#include <map>
+#include <vector>
 
 #include <QObject>
 #include <QVector>
 #include <QMutex>
+#include <QThread>
+#include <QColor>
+
+#include <qwt_plot_curve.h>
+
+#include "ffnetwork.h"
+#include "replicaaggregate.h"
 
 class Config;
-class FFNetwork;
+class MilestoneHistory;
+class ResultCache;
+class SnapshotEvaluator;
+class TelemetryWriter;
+class EtaSearch;
+class Dataset;
+class QFile;
 class QwtPlot;
 class QwtLegend;
-class QwtPlotCurve;
 class QwtPlotItem;
 class QwtPlotMarker;
+class QwtPlotIntervalCurve;
+
+/**
+  * Plot curve that remembers which eta setting it belongs to, so legend
+  * events map back to a network id without searching. The setting's mean
+  * curve carries its legend item; replica curves stay out of the legend.
+  */
+class NetworkCurve : public QwtPlotCurve
+{
+public:
+    NetworkCurve(int _id) : id(_id) {}
+    int getId() const { return id; }
+    void setId(int _id) { id = _id; }
+
+private:
+    int id;
+};
 
 class NetworkManager : public QObject
 {
@@ -22,6 +51,12 @@ class NetworkManager : public QObject
 public:
     NetworkManager(QwtPlot *_plot);
     void networksFromConfig(Config *c);
+    void setDataset(Dataset *_dataset);
+    quint64 trainedEpochs();
+    double meanFinalEpoch(int &converged);
+    QVector<FFNetwork*> getNetworks();
+    const Dataset *getDataset() const;
+    bool cleanError(FFNetwork *network, unsigned int &epoch, double &error);
 
 public slots:
     void resume();
@@ -30,28 +65,122 @@ public slots:
 
 signals:
     void stopped();
+    void networksChanged();
 
 private slots:
     void epochMilestone(int, int, int, double);
     void epochFinal(int, int, int);
+    void epochFailed(int, int, int, int);
     void legendChecked(QwtPlotItem*, bool);
+    void advanceSearch();
 
 private:
+    // one record per network, stored at id*averaged + avgId
+    struct NetworkRecord
+    {
+        FFNetwork *network;
+        MilestoneHistory *history;
+        NetworkCurve *curve;
+        int final;
+    };
+
+    // one record per setting, a combination of eta, momentum, stop and
+    // topology (shared by its averaged networks); the setting is drawn as
+    // the mean of its networks' errors with a band around it, and the
+    // networks' own curves are only shown while the setting is highlighted
+    // or every network is to be drawn. With a search, the setting is point
+    // `point` of searches[search].
+    struct SettingRecord
+    {
+        double eta;
+        double momentum;
+        double stop;
+        std::vector<unsigned int> layers;
+        int search;
+        int point;
+        // set once the setting's result is streamed out
+        bool written;
+        QColor color;
+        QwtPlotMarker *marker;
+        bool highlighted;
+        ReplicaAggregate *aggregate;
+        NetworkCurve *meanCurve;
+        QwtPlotIntervalCurve *bandCurve;
+    };
+
     int numNetworks;
-    int **finals;
     unsigned int averaged;
-    FFNetwork ***networks;
+    QVector<NetworkRecord> records;
+    QVector<SettingRecord> settings;
     QwtPlot *plot;
     QwtLegend *legend;
-    QwtPlotCurve ***curves;
-    QVector<double> ***epochMilestones;
-    QVector<double> ***errors;
     QMutex mutex;
     double minEpochMilestone;
     bool isRunning;
-    std::map<QwtPlotCurve*, bool> highlightedCurves;
-    std::map<QwtPlotCurve*, QwtPlotMarker*> markers;
 
+    // the dataset every network trains on (and references); a new one is
+    // only swapped in, and the old one deleted with its networks, at the
+    // next reconfiguration
+    Dataset *dataset;
+    Dataset *newDataset;
+
+    // settings the current networks were created with; networks are only
+    // kept across a reconfiguration if none of these changed
+    double pruneFraction;
+    Optimizer::Type optimizer;
+    FFNetwork::Engine engine;
+    unsigned int workers;
+    FFNetwork::Parallelism parallelism;
+    int historyCapacity;
+    QString spillDirectory;
+    QThread::Priority priority;
+    ReplicaAggregate::Band band;
+    bool showReplicas;
+
+    // finished runs are stored in (and reused from) the cache; replica a
+    // of a sweep is seeded with generation*0x10000 + a, and restarting
+    // moves on to the next generation
+    ResultCache *cache;
+    quint32 generation;
+
+    // measures clean full-pass errors from the networks' weight snapshots
+    SnapshotEvaluator *evaluator;
+
+    // records every epoch of every run when a telemetry file is set
+    TelemetryWriter *telemetry;
+
+    // the values swept besides eta; every combination of them is a
+    // separate eta sweep (or search)
+    QVector<double> momenta;
+    QVector<double> stops;
+    QVector<std::vector<unsigned int> > hiddenLayers;
+
+    // with a search budget, the etas of each combination are the ones
+    // proposed by its own search so far instead of the grid
+    Config *config;
+    QVector<EtaSearch*> searches;
+
+    // every finished setting is appended to the results file, if set
+    QFile *results;
+
+    NetworkRecord &record(int id, unsigned int avgId);
+    bool resolve(int &id, int &avgId);
+    MilestoneHistory *createHistory(const SettingRecord &setting, unsigned int avgId,
+                                    const QString &previousSpill = QString());
+    void buildNetworks();
+    bool isSameTraining(Config *c) const;
+    void createSearches(Config *c);
+    bool isSearchFinished() const;
+    void writeResult(int id);
+    bool isNetworkDone(int n);
+    bool isSettingDone(int id);
+    double settingCost(int id);
+    void checkStopped();
+    void loadCached(NetworkRecord &rec);
+    void openTelemetry(NetworkRecord &rec, const SettingRecord &setting, unsigned int avgId);
+    void rebuildAggregate(int id);
+    void updateAggregate(int id);
+    void updateReplicas(int id);
     void updateMarker(int id);
 };
 
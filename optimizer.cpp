@@ -0,0 +1,107 @@
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+#include "optimizer.h"
+
+Optimizer *Optimizer::create(Type type, double eta, double momentum)
+{
+    switch(type)
+    {
+    case Nesterov:
+        return new NesterovOptimizer(eta, momentum);
+    case Adam:
+        return new AdamOptimizer(eta, momentum);
+    case Rprop:
+        return new RpropOptimizer(eta, momentum);
+    case Momentum:
+    default:
+        return new MomentumOptimizer(eta, momentum);
+    }
+}
+
+void Optimizer::initState(double *state) const
+{
+    for(unsigned int s = 0; s < stateSize(); s++)
+    {
+        state[s] = 0.0;
+    }
+}
+
+double MomentumOptimizer::step(double gradient, double *state)
+{
+    double weightUpdate = eta * gradient + momentum * state[0];
+    state[0] = weightUpdate;
+    return weightUpdate;
+}
+
+double NesterovOptimizer::step(double gradient, double *state)
+{
+    // look-ahead form: apply the new velocity's momentum on top of the
+    // gradient step
+    state[0] = momentum * state[0] + eta * gradient;
+    return momentum * state[0] + eta * gradient;
+}
+
+AdamOptimizer::AdamOptimizer(double _eta, double _momentum)
+    : Optimizer(_eta, _momentum), beta1(0.9), beta2(0.999), epsilon(1e-8)
+{
+    reset();
+}
+
+void AdamOptimizer::reset()
+{
+    t = 0;
+    correction1 = 1.0;
+    correction2 = 1.0;
+}
+
+void AdamOptimizer::beginStep()
+{
+    t++;
+    correction1 = 1.0 - pow(beta1, double(t));
+    correction2 = 1.0 - pow(beta2, double(t));
+}
+
+double AdamOptimizer::step(double gradient, double *state)
+{
+    state[0] = beta1 * state[0] + (1 - beta1) * gradient;
+    state[1] = beta2 * state[1] + (1 - beta2) * gradient * gradient;
+    return eta * (state[0] / correction1) / (sqrt(state[1] / correction2) + epsilon);
+}
+
+RpropOptimizer::RpropOptimizer(double _eta, double _momentum)
+    : Optimizer(_eta, _momentum), increase(1.2), decrease(0.5),
+    initialStep(0.1), minStep(1e-6), maxStep(50.0)
+{
+}
+
+void RpropOptimizer::initState(double *state) const
+{
+    state[0] = 0.0;
+    state[1] = 0.0;
+    state[2] = initialStep;
+}
+
+double RpropOptimizer::step(double gradient, double *state)
+{
+    double sign = gradient * state[1];
+    if(sign > 0.0)
+    {
+        state[2] = min(state[2] * increase, maxStep);
+    }
+    else if(sign < 0.0)
+    {
+        // the last step jumped over a minimum; shrink the step and skip
+        // this update
+        state[2] = max(state[2] * decrease, minStep);
+        state[1] = 0.0;
+        return 0.0;
+    }
+    state[1] = gradient;
+    if(gradient > 0.0)
+        return state[2];
+    if(gradient < 0.0)
+        return -state[2];
+    return 0.0;
+}
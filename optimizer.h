@@ -0,0 +1,122 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include <QString>
+
+/**
+  * Weight update rule used by FFNetwork. Every weight owns stateSize()
+  * doubles of per-weight state in the network's weight state arena; step()
+  * turns the negative error gradient of a weight (delta * activation) into
+  * the change to apply to it.
+  *
+  * Batch optimizers are only stepped once per epoch: the network sums the
+  * gradient of every sample into the first state slot and hands the sum
+  * to step() at the end of the epoch.
+  *
+  * An optimizer ignores zero gradients if step(0) does not move the
+  * weight (momentum still does), so zero gradients need not be stepped.
+  *
+  * An optimizer counts steps if step() depends on how many times
+  * beginStep() has been called. The counter is not shared safely between
+  * threads updating the weights at once, so such optimizers cannot be
+  * trained Hogwild.
+  */
+class Optimizer
+{
+public:
+    enum Type { Momentum, Nesterov, Adam, Rprop };
+
+    static Optimizer *create(Type type, double eta, double momentum);
+    virtual ~Optimizer() {}
+
+    virtual QString name() const = 0;
+    virtual unsigned int stateSize() const = 0;
+    virtual bool isBatch() const { return false; }
+    virtual bool ignoresZeroGradients() const { return false; }
+    virtual bool countsSteps() const { return false; }
+    virtual void initState(double *state) const;
+    virtual void reset() {}
+    virtual void beginStep() {}
+    virtual double step(double gradient, double *state) = 0;
+
+protected:
+    Optimizer(double _eta, double _momentum) : eta(_eta), momentum(_momentum) {}
+
+    double eta;
+    double momentum;
+};
+
+/**
+  * Plain gradient descent with momentum; the state is the previous update.
+  */
+class MomentumOptimizer : public Optimizer
+{
+public:
+    MomentumOptimizer(double _eta, double _momentum) : Optimizer(_eta, _momentum) {}
+    QString name() const { return "momentum"; }
+    unsigned int stateSize() const { return 1; }
+    bool ignoresZeroGradients() const { return momentum == 0.0; }
+    double step(double gradient, double *state);
+};
+
+/**
+  * Nesterov momentum; the state is the velocity.
+  */
+class NesterovOptimizer : public Optimizer
+{
+public:
+    NesterovOptimizer(double _eta, double _momentum) : Optimizer(_eta, _momentum) {}
+    QString name() const { return "Nesterov"; }
+    unsigned int stateSize() const { return 1; }
+    bool ignoresZeroGradients() const { return momentum == 0.0; }
+    double step(double gradient, double *state);
+};
+
+/**
+  * Adam with eta as the step size and momentum ignored; the state is the
+  * first and second moment estimates.
+  */
+class AdamOptimizer : public Optimizer
+{
+public:
+    AdamOptimizer(double _eta, double _momentum);
+    QString name() const { return "Adam"; }
+    unsigned int stateSize() const { return 2; }
+    bool countsSteps() const { return true; }
+    void reset();
+    void beginStep();
+    double step(double gradient, double *state);
+
+private:
+    double beta1;
+    double beta2;
+    double epsilon;
+    unsigned int t;
+    double correction1;
+    double correction2;
+};
+
+/**
+  * iRPROP- (resilient backpropagation), a batch method that only uses the
+  * sign of the gradient, so eta and momentum are ignored; the state is the
+  * accumulated gradient, the previous gradient and the step size.
+  */
+class RpropOptimizer : public Optimizer
+{
+public:
+    RpropOptimizer(double _eta, double _momentum);
+    QString name() const { return "RPROP"; }
+    unsigned int stateSize() const { return 3; }
+    bool isBatch() const { return true; }
+    void initState(double *state) const;
+    double step(double gradient, double *state);
+
+private:
+    double increase;
+    double decrease;
+    double initialStep;
+    double minStep;
+    double maxStep;
+};
+
+#endif // OPTIMIZER_H
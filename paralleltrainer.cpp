@@ -0,0 +1,294 @@
+#include <vector>
+using namespace std;
+
+#include "paralleltrainer.h"
+#include "optimizer.h"
+#include "placement.h"
+
+// a synchronous round gives each worker at most this many samples, and an
+// epoch at least MinRounds rounds where the dataset allows it: bigger
+// blocks amortize the barriers, but every step covers more samples
+static const unsigned int MaxBlock = 8;
+static const unsigned int MinRounds = 16;
+
+ParallelTrainer::ParallelTrainer(FFNetwork *_network, FFNetwork::Parallelism _mode,
+                                 unsigned int _workers, QVector<int> cpus)
+    : network(_network), mode(_mode), workers(_workers), generation(0), pending(0),
+    quitNow(false), job(Shard), round(0), reduceCount(0)
+{
+    const vector<unsigned int> &layers = network->layers;
+    numWeights = network->numWeights();
+    block = qBound(1u, (unsigned int)network->inputs.size() / (workers * MinRounds), MaxBlock);
+
+    layerStart.resize(layers.size());
+    layerStart[0] = 0;
+    for(unsigned int i = 1; i < layers.size(); i++)
+        layerStart[i] = layerStart[i-1] + network->weightCount(i);
+
+    // the helpers allocate their own buffers, once pinned
+    scratch.resize(workers);
+    for(unsigned int w = 0; w < workers; w++)
+    {
+        Scratch &s = scratch[w];
+        s.neuronVals = NULL;
+        s.delta = NULL;
+        s.gradients = NULL;
+        s.norms = new double[layers.size()-1];
+        s.error = 0.0;
+    }
+    allocate(0);
+
+    QThread::Priority priority = network->priority();
+    for(unsigned int w = 1; w < workers; w++)
+    {
+        Worker *thread = new Worker(this, w, (int(w) < cpus.size()) ? cpus[w] : -1);
+        threads << thread;
+        thread->start(priority);
+    }
+}
+
+ParallelTrainer::~ParallelTrainer()
+{
+    mutex.lock();
+    quitNow = true;
+    startCond.wakeAll();
+    mutex.unlock();
+
+    for(int t = 0; t < threads.size(); t++)
+    {
+        threads[t]->wait();
+        delete threads[t];
+    }
+
+    for(unsigned int w = 0; w < workers; w++)
+    {
+        if(w != 0 && scratch[w].neuronVals != NULL)
+        {
+            for(unsigned int i = 0; i < network->layers.size(); i++)
+                delete[] scratch[w].neuronVals[i];
+            for(unsigned int i = 1; i < network->layers.size(); i++)
+                delete[] scratch[w].delta[i-1];
+            delete[] scratch[w].neuronVals;
+            delete[] scratch[w].delta;
+        }
+        delete[] scratch[w].gradients;
+        delete[] scratch[w].norms;
+    }
+}
+
+/**
+  * Allocates worker w's buffers; called from the worker's own thread.
+  * Worker 0 is the network's own thread and uses the network's buffers.
+  */
+void ParallelTrainer::allocate(unsigned int w)
+{
+    const vector<unsigned int> &layers = network->layers;
+    Scratch &s = scratch[w];
+    if(w == 0)
+    {
+        s.neuronVals = network->neuronVals;
+        s.delta = network->delta;
+    }
+    else
+    {
+        s.neuronVals = new double*[layers.size()];
+        s.delta = new double*[layers.size()-1];
+        for(unsigned int i = 0; i < layers.size(); i++)
+            s.neuronVals[i] = new double[layers[i]];
+        for(unsigned int i = 1; i < layers.size(); i++)
+            s.delta[i-1] = new double[layers[i]];
+    }
+    s.gradients = new double[numWeights];
+    for(unsigned int n = 0; n < numWeights; n++)
+        s.gradients[n] = 0.0;
+}
+
+ParallelTrainer::Worker::Worker(ParallelTrainer *_trainer, unsigned int _w, int _cpu)
+    : trainer(_trainer), w(_w), cpu(_cpu)
+{
+}
+
+void ParallelTrainer::Worker::run()
+{
+    if(cpu >= 0)
+    {
+        Placement::pinCurrentThread(cpu);
+    }
+    // a job handed out meanwhile is picked up below, seen starts at 0
+    trainer->allocate(w);
+
+    unsigned int seen = 0;
+    forever
+    {
+        trainer->mutex.lock();
+        while(trainer->generation == seen && !trainer->quitNow)
+        {
+            trainer->startCond.wait(&trainer->mutex);
+        }
+        if(trainer->quitNow)
+        {
+            trainer->mutex.unlock();
+            return;
+        }
+        seen = trainer->generation;
+        trainer->mutex.unlock();
+
+        trainer->work(w);
+
+        trainer->mutex.lock();
+        if(--trainer->pending == 0)
+            trainer->doneCond.wakeAll();
+        trainer->mutex.unlock();
+    }
+}
+
+/**
+  * Trains one epoch over network->ordering (already shuffled); returns the
+  * summed error like a sequential epoch.
+  */
+double ParallelTrainer::epoch()
+{
+    Optimizer *optimizer = network->optimizer;
+    unsigned int samples = network->inputs.size();
+
+    for(unsigned int w = 0; w < workers; w++)
+    {
+        scratch[w].error = 0.0;
+        for(unsigned int i = 1; i < network->layers.size(); i++)
+            scratch[w].norms[i-1] = 0.0;
+    }
+
+    if(network->batch)
+    {
+        runJob(Shard);
+        reduceCount = workers;
+        runJob(Reduce);
+    }
+    else if(mode == FFNetwork::Hogwild)
+    {
+        // the workers only call step(); optimizers that count steps are
+        // never trained Hogwild (see FFNetwork::setParallelism())
+        runJob(Shard);
+    }
+    else
+    {
+        for(round = 0; round*workers*block < samples; round++)
+        {
+            runJob(Round);
+            // the last round may leave some workers without samples
+            unsigned int left = samples - round*workers*block;
+            reduceCount = qMin(workers, (left + block - 1) / block);
+            optimizer->beginStep();
+            runJob(Reduce);
+        }
+    }
+
+    double error = 0.0;
+    for(unsigned int w = 0; w < workers; w++)
+    {
+        error += scratch[w].error;
+        if(network->measureGradients)
+        {
+            for(unsigned int i = 1; i < network->layers.size(); i++)
+                network->gradientNorms[i-1] += scratch[w].norms[i-1];
+        }
+    }
+    return error;
+}
+
+/**
+  * Hands the job to the helper threads, does worker 0's share on the
+  * calling thread and waits for the rest.
+  */
+void ParallelTrainer::runJob(Job _job)
+{
+    mutex.lock();
+    job = _job;
+    pending = workers - 1;
+    generation++;
+    startCond.wakeAll();
+    mutex.unlock();
+
+    work(0);
+
+    mutex.lock();
+    while(pending > 0)
+    {
+        doneCond.wait(&mutex);
+    }
+    mutex.unlock();
+}
+
+void ParallelTrainer::work(unsigned int w)
+{
+    unsigned int samples = network->inputs.size();
+
+    if(job == Shard)
+    {
+        train(scratch[w], samples * w / workers, samples * (w+1) / workers);
+    }
+    else if(job == Round)
+    {
+        unsigned int begin = qMin((round*workers + w) * block, samples);
+        train(scratch[w], begin, qMin(begin + block, samples));
+    }
+    else
+    {
+        reduce(w);
+    }
+}
+
+/**
+  * Trains samples begin to end of the epoch's order with worker s's
+  * buffers.
+  */
+void ParallelTrainer::train(Scratch &s, unsigned int begin, unsigned int end)
+{
+    const unsigned int *ordering = network->ordering;
+    // Hogwild updates the shared weights directly
+    double *gradients = (mode == FFNetwork::Hogwild && !network->batch) ? NULL : s.gradients;
+
+    for(unsigned int n = begin; n < end; n++)
+    {
+        s.error += network->trainSample(ordering[n], s.neuronVals, s.delta, gradients);
+        if(network->measureGradients)
+            network->accumulateGradientNorms(s.neuronVals, s.delta, s.norms);
+    }
+}
+
+/**
+  * Adds up worker w's slice of the gradients of the first reduceCount
+  * workers and clears them, then either takes one optimizer step with
+  * the sum or, for batch optimizers, adds it to the epoch's accumulated
+  * gradient. The optimizer's step counter has already been advanced.
+  */
+void ParallelTrainer::reduce(unsigned int w)
+{
+    Optimizer *optimizer = network->optimizer;
+    unsigned int stateSize = network->stateSize;
+    unsigned int begin = numWeights * w / workers;
+    unsigned int end = numWeights * (w+1) / workers;
+    double gradient;
+    double *state;
+
+    for(unsigned int i = 1; i < network->layers.size(); i++)
+    {
+        unsigned int first = qMax(begin, layerStart[i-1]);
+        unsigned int last = qMin(end, layerStart[i-1] + network->weightCount(i));
+        for(unsigned int n = first; n < last; n++)
+        {
+            gradient = 0.0;
+            for(unsigned int v = 0; v < reduceCount; v++)
+            {
+                gradient += scratch[v].gradients[n];
+                scratch[v].gradients[n] = 0.0;
+            }
+            unsigned int b = n - layerStart[i-1];
+            state = &network->weightState[i-1][b*stateSize];
+            if(network->batch)
+                state[0] += gradient;
+            else
+                network->weights[i-1][b] += optimizer->step(gradient, state);
+        }
+    }
+}
@@ -0,0 +1,99 @@
+#ifndef PARALLELTRAINER_H
+#define PARALLELTRAINER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector>
+
+#include "ffnetwork.h"
+
+/**
+  * Data-parallel backprop for one dense network. The network's own thread
+  * acts as worker 0, and workers-1 helper threads are kept waiting between
+  * jobs. Each worker has its own activation and delta buffers. The workers
+  * share the network's weights and split each epoch's sample order.
+  *
+  * Hogwild: each worker trains its own contiguous shard of the order and
+  * updates the shared weights without locking. Optimizers that count
+  * steps are never trained this way.
+  *
+  * Synchronous: in each round every worker sums the gradients of a block
+  * of consecutive samples. The total of the workers' sums then gets a
+  * single optimizer step, which to first order in eta moves the weights
+  * as far as training all of the round's samples sequentially would.
+  *
+  * For batch optimizers both modes accumulate per-worker gradients and add
+  * them up at the end of the epoch, which gives the same result as
+  * sequential training.
+  *
+  * The per-worker gradients are reduced in parallel as well: each worker
+  * adds up (and steps) its own slice of the weights over all workers.
+  * Helper threads run at the network thread's priority, and allocate
+  * their buffers once pinned, so the memory is placed on their node.
+  */
+class ParallelTrainer
+{
+public:
+    ParallelTrainer(FFNetwork *_network, FFNetwork::Parallelism _mode,
+                    unsigned int _workers, QVector<int> cpus);
+    ~ParallelTrainer();
+    double epoch();
+
+private:
+    class Worker : public QThread
+    {
+    public:
+        Worker(ParallelTrainer *_trainer, unsigned int _w, int _cpu);
+        void run();
+
+    private:
+        ParallelTrainer *trainer;
+        unsigned int w;
+        int cpu;
+    };
+
+    enum Job { Shard, Round, Reduce };
+
+    // per-worker buffers; gradients has one entry per (dense) weight
+    struct Scratch
+    {
+        double **neuronVals;
+        double **delta;
+        double *gradients;
+        // squared gradient norm per weight layer, for epochs that measure it
+        double *norms;
+        double error;
+    };
+
+    FFNetwork *network;
+    FFNetwork::Parallelism mode;
+    unsigned int workers;
+    unsigned int numWeights;
+    // samples per worker in a synchronous round
+    unsigned int block;
+    // index of each weight layer's first weight, in getWeights() order
+    std::vector<unsigned int> layerStart;
+    QVector<Scratch> scratch;
+    QVector<Worker*> threads;
+
+    QMutex mutex;
+    QWaitCondition startCond;
+    QWaitCondition doneCond;
+    unsigned int generation;
+    unsigned int pending;
+    bool quitNow;
+    // the current job: a whole-epoch shard, a round of the synchronous
+    // mode or a reduction of the gradients of the first reduceCount workers
+    Job job;
+    unsigned int round;
+    unsigned int reduceCount;
+
+    void allocate(unsigned int w);
+    void runJob(Job _job);
+    void work(unsigned int w);
+    void train(Scratch &s, unsigned int begin, unsigned int end);
+    void reduce(unsigned int w);
+};
+
+#endif // PARALLELTRAINER_H
@@ -0,0 +1,156 @@
+#include <QDir>
+#include <QFile>
+#include <QMap>
+#include <QStringList>
+#include <QThread>
+
+#ifdef Q_OS_LINUX
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "placement.h"
+
+Placement::Placement(Policy _policy)
+    : policy(_policy)
+{
+    if(policy != None)
+    {
+        readTopology();
+    }
+}
+
+/**
+  * CPU that worker number `worker` should be pinned to, or -1 if workers
+  * are left to the scheduler.
+  */
+int Placement::cpuFor(int worker) const
+{
+    if(policy == None || nodes.isEmpty())
+        return -1;
+
+    if(policy == Scatter)
+    {
+        const QVector<int> &node = nodes[worker % nodes.size()];
+        return node[(worker / nodes.size()) % node.size()];
+    }
+
+    int total = 0;
+    for(int n = 0; n < nodes.size(); n++)
+        total += nodes[n].size();
+    int slot = worker % total;
+    for(int n = 0; n < nodes.size(); n++)
+    {
+        if(slot < nodes[n].size())
+            return nodes[n][slot];
+        slot -= nodes[n].size();
+    }
+    return -1;
+}
+
+int Placement::numNodes() const
+{
+    return nodes.size();
+}
+
+/**
+  * Restricts the calling thread to the given CPU. Memory the thread touches
+  * first afterwards is then allocated on that CPU's node by the kernel's
+  * default (first-touch) policy.
+  */
+bool Placement::pinCurrentThread(int cpu)
+{
+#ifdef Q_OS_LINUX
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    Q_UNUSED(cpu);
+    return false;
+#endif
+}
+
+/**
+  * Reads the CPUs of every node directory in sysfs. Node numbers need not
+  * be contiguous (offline or memory-only nodes leave gaps), and only the
+  * CPUs the process may run on are kept, so a node left without any (e.g.
+  * under taskset or a cpuset) is dropped.
+  */
+void Placement::readTopology()
+{
+    QVector<int> allowed = allowedCpus();
+    QDir dir("/sys/devices/system/node");
+    QStringList entries = dir.entryList(QStringList() << "node*", QDir::Dirs);
+    QMap<int, QVector<int> > byNumber;
+    for(int e = 0; e < entries.size(); e++)
+    {
+        bool ok;
+        int n = entries[e].mid(4).toInt(&ok);
+        if(!ok)
+            continue;
+        QFile file(dir.filePath(entries[e] + "/cpulist"));
+        if(!file.open(QIODevice::ReadOnly))
+            continue;
+        QVector<int> cpus = parseCpuList(QString(file.readAll()).trimmed());
+        QVector<int> usable;
+        for(int c = 0; c < cpus.size(); c++)
+        {
+            if(allowed.isEmpty() || allowed.contains(cpus[c]))
+                usable << cpus[c];
+        }
+        if(!usable.isEmpty())
+            byNumber.insert(n, usable);
+    }
+    nodes = byNumber.values().toVector();
+
+    if(nodes.isEmpty())
+    {
+        if(allowed.isEmpty())
+        {
+            for(int c = 0; c < QThread::idealThreadCount(); c++)
+                allowed << c;
+        }
+        nodes << allowed;
+    }
+}
+
+/**
+  * CPUs in the process's affinity mask, or an empty list if it cannot be
+  * read.
+  */
+QVector<int> Placement::allowedCpus()
+{
+    QVector<int> cpus;
+#ifdef Q_OS_LINUX
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if(sched_getaffinity(0, sizeof(set), &set) == 0)
+    {
+        for(int c = 0; c < CPU_SETSIZE; c++)
+        {
+            if(CPU_ISSET(c, &set))
+                cpus << c;
+        }
+    }
+#endif
+    return cpus;
+}
+
+/**
+  * Parses a sysfs CPU list such as "0-3,8-11".
+  */
+QVector<int> Placement::parseCpuList(QString list)
+{
+    QVector<int> cpus;
+    QStringList ranges = list.split(",", QString::SkipEmptyParts);
+    for(int r = 0; r < ranges.size(); r++)
+    {
+        QStringList bounds = ranges[r].split("-");
+        int first = bounds[0].toInt();
+        int last = (bounds.size() > 1) ? bounds[1].toInt() : first;
+        for(int c = first; c <= last; c++)
+            cpus << c;
+    }
+    return cpus;
+}
@@ -0,0 +1,38 @@
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+#include <QVector>
+#include <QString>
+
+/**
+  * Decides which CPU each training worker is pinned to. The NUMA topology
+  * is read from sysfs (Linux), limited to the CPUs the process may run on;
+  * elsewhere, or if it cannot be read, every CPU is treated as belonging
+  * to one node.
+  *
+  * Compact fills the CPUs of one node before moving to the next (workers
+  * share caches and memory), scatter deals workers round-robin across
+  * nodes (workers get the most memory bandwidth).
+  */
+class Placement
+{
+public:
+    enum Policy { None, Compact, Scatter };
+
+    Placement(Policy _policy);
+    int cpuFor(int worker) const;
+    int numNodes() const;
+
+    static bool pinCurrentThread(int cpu);
+
+private:
+    Policy policy;
+    // CPUs of every node, nodes in order
+    QVector<QVector<int> > nodes;
+
+    void readTopology();
+    static QVector<int> allowedCpus();
+    static QVector<int> parseCpuList(QString list);
+};
+
+#endif // PLACEMENT_H
@@ -0,0 +1,197 @@
+#include <vector>
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+#if defined(__GNUC__) && (__GNUC__ >= 8) && (defined(__x86_64__) || defined(__i386__))
+#define QUANTIZED_X86
+#include <immintrin.h>
+#endif
+
+#include "quantizednetwork.h"
+
+static const int activationMax = 127;
+
+static qint32 dotScalar(const quint8 *a, const qint8 *w, unsigned int n)
+{
+    qint32 sum = 0;
+    for(unsigned int k = 0; k < n; k++)
+    {
+        sum += qint32(a[k]) * qint32(w[k]);
+    }
+    return sum;
+}
+
+#ifdef QUANTIZED_X86
+__attribute__((target("avx2")))
+static inline qint32 horizontalSum(__m256i v)
+{
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(s);
+}
+
+__attribute__((target("avx2")))
+static qint32 dotAvx2(const quint8 *a, const qint8 *w, unsigned int n)
+{
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i sum = _mm256_setzero_si256();
+    for(unsigned int k = 0; k < n; k += 32)
+    {
+        __m256i va = _mm256_loadu_si256((const __m256i *)(a + k));
+        __m256i vw = _mm256_loadu_si256((const __m256i *)(w + k));
+        // u8 x s8 pairs summed to s16 (cannot saturate with 7-bit a), then
+        // pairs of those summed to s32
+        __m256i pairs = _mm256_maddubs_epi16(va, vw);
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(pairs, ones));
+    }
+    return horizontalSum(sum);
+}
+
+__attribute__((target("avx2,avx512vnni,avx512vl")))
+static qint32 dotVnni(const quint8 *a, const qint8 *w, unsigned int n)
+{
+    __m256i sum = _mm256_setzero_si256();
+    for(unsigned int k = 0; k < n; k += 32)
+    {
+        __m256i va = _mm256_loadu_si256((const __m256i *)(a + k));
+        __m256i vw = _mm256_loadu_si256((const __m256i *)(w + k));
+        sum = _mm256_dpbusd_epi32(sum, va, vw);
+    }
+    return horizontalSum(sum);
+}
+#endif
+
+/**
+  * Quantizes denseWeights (FFNetwork's weight layout, dense). The input
+  * range is taken from inputs.
+  */
+QuantizedNetwork::QuantizedNetwork(const vector<unsigned int> &_layers,
+                                   const vector<double> &denseWeights,
+                                   const vector<vector<double> > &inputs)
+    : layers(_layers), dot(dotScalar), kernel("scalar")
+{
+#ifdef QUANTIZED_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512vnni") && __builtin_cpu_supports("avx512vl"))
+    {
+        dot = dotVnni;
+        kernel = "AVX-512 VNNI";
+    }
+    else if(__builtin_cpu_supports("avx2"))
+    {
+        dot = dotAvx2;
+        kernel = "AVX2";
+    }
+#endif
+
+    // the inputs are mapped onto 0..activationMax over the training set's range
+    double inputMax = 0.0;
+    inputMin = 0.0;
+    for(unsigned int k = 0; k < inputs.size(); k++)
+    {
+        for(unsigned int w = 0; w < layers[0]; w++)
+        {
+            double x = inputs[k][w];
+            if((k == 0 && w == 0) || x < inputMin) inputMin = x;
+            if((k == 0 && w == 0) || x > inputMax) inputMax = x;
+        }
+    }
+    inputScale = (inputMax > inputMin) ? (inputMax - inputMin) / activationMax : 1.0;
+
+    unsigned int numLayers = layers.size();
+    stride.resize(numLayers - 1);
+    weights.resize(numLayers - 1);
+    scales.resize(numLayers - 1);
+    biases.resize(numLayers - 1);
+    rowSums.resize(numLayers - 1);
+    activations.resize(numLayers - 1);
+
+    const double *row = &denseWeights[0];
+    for(unsigned int i = 1; i < numLayers; i++)
+    {
+        unsigned int p = layers[i-1];
+        stride[i-1] = (p + 31) / 32 * 32;
+        weights[i-1].assign(layers[i] * stride[i-1], 0);
+        scales[i-1].resize(layers[i]);
+        biases[i-1].resize(layers[i]);
+        rowSums[i-1].resize(layers[i]);
+        // zero padding makes the padded tail of every dot product vanish
+        activations[i-1].assign(stride[i-1], 0);
+
+        for(unsigned int j = 0; j < layers[i]; j++, row += p+1)
+        {
+            double maxAbs = 0.0;
+            for(unsigned int w = 0; w < p; w++)
+            {
+                maxAbs = max(maxAbs, fabs(row[w]));
+            }
+            double scale = (maxAbs > 0.0) ? maxAbs / 127.0 : 1.0;
+            qint32 rowSum = 0;
+            for(unsigned int w = 0; w < p; w++)
+            {
+                int q = int(floor(row[w] / scale + 0.5));
+                q = max(-127, min(127, q));
+                weights[i-1][j*stride[i-1] + w] = qint8(q);
+                rowSum += q;
+            }
+            scales[i-1][j] = scale;
+            biases[i-1][j] = row[p];
+            rowSums[i-1][j] = rowSum;
+        }
+    }
+}
+
+vector<double> QuantizedNetwork::evaluate(const vector<double> &input)
+{
+    unsigned int last = layers.size() - 1;
+    vector<double> output(layers[last]);
+
+    for(unsigned int w = 0; w < layers[0]; w++)
+    {
+        int q = int(floor((input[w] - inputMin) / inputScale + 0.5));
+        activations[0][w] = quint8(max(0, min(activationMax, q)));
+    }
+
+    double inScale = inputScale;
+    double inMin = inputMin;
+    for(unsigned int i = 1; i <= last; i++)
+    {
+        const quint8 *in = &activations[i-1][0];
+        for(unsigned int j = 0; j < layers[i]; j++)
+        {
+            qint32 acc = dot(in, &weights[i-1][j*stride[i-1]], stride[i-1]);
+            double sum = scales[i-1][j] * (inScale * acc + inMin * rowSums[i-1][j])
+                         + biases[i-1][j];
+            double value = 1.0/(1.0+exp(-sum));
+            if(i == last)
+                output[j] = value;
+            else
+                activations[i][j] = quint8(int(value * activationMax + 0.5));
+        }
+        inScale = 1.0 / activationMax;
+        inMin = 0.0;
+    }
+    return output;
+}
+
+/**
+  * Bytes of model data: the int8 weights plus each neuron's scale, bias
+  * and weight sum (padding excluded).
+  */
+unsigned int QuantizedNetwork::sizeBytes() const
+{
+    unsigned int bytes = 0;
+    for(unsigned int i = 1; i < layers.size(); i++)
+    {
+        bytes += layers[i] * layers[i-1] * sizeof(qint8);
+        bytes += layers[i] * (2 * sizeof(double) + sizeof(qint32));
+    }
+    return bytes;
+}
+
+const char *QuantizedNetwork::kernelName() const
+{
+    return kernel;
+}
@@ -0,0 +1,48 @@
+#ifndef QUANTIZEDNETWORK_H
+#define QUANTIZEDNETWORK_H
+
+#include <vector>
+
+#include <QtGlobal>
+
+/**
+  * Post-training int8 copy of a network's dense weights (e.g. from its
+  * WeightSnapshot) for inference only. Weights are
+  * quantized symmetrically with one scale per neuron. Activations are
+  * 7-bit unsigned: sigmoid outputs map to 0..127, and the network's inputs
+  * map onto that range with an offset taken from the training set. Dot
+  * products accumulate in int32. On x86 the kernel is chosen at run time:
+  * AVX-512 VNNI, then AVX2, then scalar code. 7-bit activations keep the
+  * AVX2 pairwise 16-bit sums from saturating.
+  */
+class QuantizedNetwork
+{
+public:
+    QuantizedNetwork(const std::vector<unsigned int> &_layers,
+                     const std::vector<double> &denseWeights,
+                     const std::vector<std::vector<double> > &inputs);
+
+    std::vector<double> evaluate(const std::vector<double> &input);
+    unsigned int sizeBytes() const;
+    const char *kernelName() const;
+
+    typedef qint32 (*DotKernel)(const quint8 *a, const qint8 *w, unsigned int n);
+
+private:
+    std::vector<unsigned int> layers;
+    // per weight layer: rows padded to stride bytes (a multiple of 32),
+    // the scale and bias of every neuron and the sum of its quantized
+    // weights (for the input offset)
+    std::vector<unsigned int> stride;
+    std::vector<std::vector<qint8> > weights;
+    std::vector<std::vector<double> > scales;
+    std::vector<std::vector<double> > biases;
+    std::vector<std::vector<qint32> > rowSums;
+    double inputMin;
+    double inputScale;
+    std::vector<std::vector<quint8> > activations;
+    DotKernel dot;
+    const char *kernel;
+};
+
+#endif // QUANTIZEDNETWORK_H
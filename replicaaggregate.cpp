@@ -0,0 +1,152 @@
+#include <cmath>
+
+#include "replicaaggregate.h"
+#include "milestonehistory.h"
+
+ReplicaAggregate::ReplicaAggregate(int _replicas, int _capacity, Band _band)
+    : band(_band), latest(_replicas, 0.0), reported(_replicas, false)
+{
+    capacity = _capacity < 16 ? 16 : _capacity;
+}
+
+void ReplicaAggregate::update(int replica, double epoch, double error)
+{
+    latest[replica] = error;
+    reported[replica] = true;
+
+    double sum = 0.0;
+    double sumSquares = 0.0;
+    double lo = error;
+    double hi = error;
+    int count = 0;
+    for(int r = 0; r < latest.size(); r++)
+    {
+        if(!reported[r]) continue;
+        sum += latest[r];
+        sumSquares += latest[r] * latest[r];
+        if(latest[r] < lo) lo = latest[r];
+        if(latest[r] > hi) hi = latest[r];
+        count++;
+    }
+    double mean = sum / count;
+    if(band == StdDev)
+    {
+        double variance = sumSquares / count - mean * mean;
+        double stddev = variance > 0.0 ? sqrt(variance) : 0.0;
+        lo = mean - stddev;
+        hi = mean + stddev;
+    }
+
+    // a replica lagging behind the others revises the newest point rather
+    // than stepping the curve back
+    if(!epochData.isEmpty() && epoch <= epochData.last())
+    {
+        meanData.last() = mean;
+        lowerData.last() = lo;
+        upperData.last() = hi;
+        return;
+    }
+
+    epochData << epoch;
+    meanData << mean;
+    lowerData << lo;
+    upperData << hi;
+    if(epochData.size() > capacity)
+    {
+        halve();
+    }
+}
+
+/**
+  * Replays the replicas' histories in epoch order, for when the summary
+  * has to be built from points that are already recorded (cached results,
+  * a restart or a reconfiguration).
+  */
+void ReplicaAggregate::rebuild(const QVector<MilestoneHistory*> &histories)
+{
+    clear();
+    QVector<int> next(histories.size(), 0);
+    forever
+    {
+        int replica = -1;
+        double epoch = 0.0;
+        for(int r = 0; r < histories.size(); r++)
+        {
+            if(next[r] >= histories[r]->epochs().size()) continue;
+            if(replica == -1 || histories[r]->epochs()[next[r]] < epoch)
+            {
+                replica = r;
+                epoch = histories[r]->epochs()[next[r]];
+            }
+        }
+        if(replica == -1)
+            break;
+        update(replica, epoch, histories[replica]->errors()[next[replica]]);
+        next[replica]++;
+    }
+}
+
+void ReplicaAggregate::clear()
+{
+    latest.fill(0.0);
+    reported.fill(false);
+    epochData.clear();
+    meanData.clear();
+    lowerData.clear();
+    upperData.clear();
+}
+
+bool ReplicaAggregate::isEmpty() const
+{
+    return epochData.isEmpty();
+}
+
+const QVector<double> &ReplicaAggregate::epochs() const
+{
+    return epochData;
+}
+
+const QVector<double> &ReplicaAggregate::means() const
+{
+    return meanData;
+}
+
+const QVector<double> &ReplicaAggregate::lower() const
+{
+    return lowerData;
+}
+
+const QVector<double> &ReplicaAggregate::upper() const
+{
+    return upperData;
+}
+
+/**
+  * Merges adjacent points, halving their number; a merged point sits at
+  * the later epoch, with the mean of both and the outer edges of both
+  * bands.
+  */
+void ReplicaAggregate::halve()
+{
+    int count = epochData.size();
+    int out = 0;
+    for(int p = 0; p < count; p += 2, out++)
+    {
+        if(p + 1 == count)
+        {
+            epochData[out] = epochData[p];
+            meanData[out] = meanData[p];
+            lowerData[out] = lowerData[p];
+            upperData[out] = upperData[p];
+            continue;
+        }
+        epochData[out] = epochData[p+1];
+        meanData[out] = 0.5 * (meanData[p] + meanData[p+1]);
+        lowerData[out] = qMin(lowerData[p], lowerData[p+1]);
+        upperData[out] = qMax(upperData[p], upperData[p+1]);
+    }
+    epochData.resize(out);
+    meanData.resize(out);
+    lowerData.resize(out);
+    upperData.resize(out);
+}
@@ -0,0 +1,49 @@
+#ifndef REPLICAAGGREGATE_H
+#define REPLICAAGGREGATE_H
+
+#include <QVector>
+
+class MilestoneHistory;
+
+/**
+  * Running summary of the error curves of the averaged networks (replicas)
+  * of one eta setting: the mean error with a band around it, either the
+  * min/max or one standard deviation either side of the mean. Every
+  * milestone updates that replica's current error and the point at the
+  * furthest epoch reached so far, so the summary is built incrementally in
+  * O(replicas) per milestone. Once the series outgrows its capacity,
+  * adjacent points are merged (keeping the outer band edges) and its
+  * resolution halves.
+  */
+class ReplicaAggregate
+{
+public:
+    enum Band { MinMax, StdDev };
+
+    ReplicaAggregate(int _replicas, int _capacity, Band _band);
+
+    void update(int replica, double epoch, double error);
+    void rebuild(const QVector<MilestoneHistory*> &histories);
+    void clear();
+    bool isEmpty() const;
+    const QVector<double> &epochs() const;
+    const QVector<double> &means() const;
+    const QVector<double> &lower() const;
+    const QVector<double> &upper() const;
+
+private:
+    Band band;
+    int capacity;
+    // current error of every replica; replicas that have not reported yet
+    // are left out of the summary
+    QVector<double> latest;
+    QVector<bool> reported;
+    QVector<double> epochData;
+    QVector<double> meanData;
+    QVector<double> lowerData;
+    QVector<double> upperData;
+
+    void halve();
+};
+
+#endif // REPLICAAGGREGATE_H
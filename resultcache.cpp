@@ -0,0 +1,104 @@
+#include "resultcache.h"
+
+// identifies the file format; bumped whenever the record layout changes
+static const quint32 cacheMagic = 0x4e4e5243;
+static const quint32 cacheVersion = 1;
+
+ResultCache::ResultCache(QString _fileName)
+    : validSize(0)
+{
+    file.setFileName(_fileName);
+    load();
+    if(file.open(QIODevice::WriteOnly | QIODevice::Append))
+    {
+        // drops a record cut short, so new ones are not appended after
+        // it, or the whole file if it has another format or version
+        if(file.size() != validSize)
+            file.resize(validSize);
+        stream.setDevice(&file);
+        stream.setVersion(QDataStream::Qt_4_6);
+        if(validSize == 0)
+        {
+            stream << cacheMagic << cacheVersion;
+        }
+    }
+}
+
+ResultCache::~ResultCache()
+{
+    if(file.isOpen())
+        file.close();
+}
+
+QString ResultCache::fileName() const
+{
+    return file.fileName();
+}
+
+/**
+  * Reads every record of an existing cache file into the index. A record
+  * cut short (e.g. by a crash while appending) ends the scan; later
+  * records for the same key replace earlier ones. validSize is left at
+  * the end of the last whole record, or 0 if the header does not match.
+  */
+void ResultCache::load()
+{
+    if(!file.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_4_6);
+    quint32 magic, version;
+    in >> magic >> version;
+    if(in.status() == QDataStream::Ok && magic == cacheMagic && version == cacheVersion)
+    {
+        validSize = file.pos();
+        while(!in.atEnd())
+        {
+            quint64 k;
+            qint32 final;
+            Entry entry;
+            in >> k >> final >> entry.epochs >> entry.errors;
+            if(in.status() != QDataStream::Ok || entry.epochs.size() != entry.errors.size())
+                break;
+            entry.final = final;
+            entries.insert(k, entry);
+            validSize = file.pos();
+        }
+    }
+    file.close();
+}
+
+bool ResultCache::lookup(const QByteArray &signature, Entry &entry) const
+{
+    quint64 k = key(signature);
+    if(!entries.contains(k))
+        return false;
+    entry = entries.value(k);
+    return true;
+}
+
+void ResultCache::store(const QByteArray &signature, const Entry &entry)
+{
+    quint64 k = key(signature);
+    entries.insert(k, entry);
+    if(file.isOpen())
+    {
+        stream << k << qint32(entry.final) << entry.epochs << entry.errors;
+        file.flush();
+    }
+}
+
+/**
+  * 64-bit FNV-1a hash of a configuration signature.
+  */
+quint64 ResultCache::key(const QByteArray &signature)
+{
+    quint64 h = Q_UINT64_C(14695981039346656037);
+    for(int i = 0; i < signature.size(); i++)
+    {
+        h ^= quint8(signature[i]);
+        h *= Q_UINT64_C(1099511628211);
+    }
+    return h;
+}
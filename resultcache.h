@@ -0,0 +1,49 @@
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include <QHash>
+#include <QVector>
+#include <QString>
+#include <QByteArray>
+#include <QFile>
+#include <QDataStream>
+
+/**
+  * Append-only store of finished training runs, keyed by a hash of the
+  * network's full configuration and seed (see FFNetwork::signature()).
+  * Each entry holds the epochs to converge and the (downsampled) error
+  * curve. The whole file is indexed when the cache is opened; later
+  * results are appended, so several runs of the simulator can share it.
+  * A torn last record is cut off before appending, and a file written in
+  * another format is started over.
+  */
+class ResultCache
+{
+public:
+    struct Entry
+    {
+        int final;
+        QVector<double> epochs;
+        QVector<double> errors;
+    };
+
+    ResultCache(QString _fileName);
+    ~ResultCache();
+
+    QString fileName() const;
+    bool lookup(const QByteArray &signature, Entry &entry) const;
+    void store(const QByteArray &signature, const Entry &entry);
+
+    static quint64 key(const QByteArray &signature);
+
+private:
+    QFile file;
+    QDataStream stream;
+    // bytes of the file holding the header and whole records
+    qint64 validSize;
+    QHash<quint64, Entry> entries;
+
+    void load();
+};
+
+#endif // RESULTCACHE_H
@@ -0,0 +1,115 @@
+#include <vector>
+using namespace std;
+
+#include <QList>
+
+#include "snapshotevaluator.h"
+#include "ffnetwork.h"
+#include "weightsnapshot.h"
+
+SnapshotEvaluator::SnapshotEvaluator()
+    : interval(250), quitNow(false)
+{
+}
+
+void SnapshotEvaluator::setDataset(const vector<vector<double> > &_inputs,
+                                   const vector<vector<double> > &_expected)
+{
+    mutex.lock();
+    inputs = _inputs;
+    expected = _expected;
+    mutex.unlock();
+}
+
+void SnapshotEvaluator::setInterval(int msecs)
+{
+    mutex.lock();
+    interval = msecs;
+    mutex.unlock();
+}
+
+void SnapshotEvaluator::add(FFNetwork *network)
+{
+    Result result;
+    result.valid = false;
+    result.epoch = 0;
+    result.error = 0.0;
+    mutex.lock();
+    results.insert(network, result);
+    mutex.unlock();
+}
+
+/**
+  * Stops evaluating network; once this returns the network may be deleted.
+  */
+void SnapshotEvaluator::remove(FFNetwork *network)
+{
+    mutex.lock();
+    results.remove(network);
+    mutex.unlock();
+}
+
+/**
+  * Latest clean error of network and the epoch of the snapshot it was
+  * measured on; false if it has not been evaluated yet.
+  */
+bool SnapshotEvaluator::result(FFNetwork *network, unsigned int &epoch, double &error)
+{
+    mutex.lock();
+    Result r = results.value(network);
+    mutex.unlock();
+    if(!r.valid)
+        return false;
+    epoch = r.epoch;
+    error = r.error;
+    return true;
+}
+
+void SnapshotEvaluator::run()
+{
+    vector<double> weights;
+    unsigned int epoch;
+
+    mutex.lock();
+    forever
+    {
+        wakeCond.wait(&mutex, interval);
+        if(quitNow)
+        {
+            mutex.unlock();
+            return;
+        }
+
+        // each network is evaluated under the mutex so remove() cannot
+        // delete it from under us; the mutex is released in between so
+        // the GUI thread waits for at most one evaluation
+        QList<FFNetwork*> networks = results.keys();
+        for(int n = 0; n < networks.size(); n++)
+        {
+            if(n > 0)
+            {
+                mutex.unlock();
+                mutex.lock();
+            }
+            if(quitNow || !results.contains(networks[n]))
+                continue;
+            const WeightSnapshot *snapshot = networks[n]->getSnapshot();
+            if(!snapshot->read(weights, epoch))
+                continue;
+            Result &r = results[networks[n]];
+            if(r.valid && r.epoch == epoch)
+                continue;
+            r.error = snapshot->error(weights, inputs, expected);
+            r.epoch = epoch;
+            r.valid = true;
+        }
+    }
+}
+
+void SnapshotEvaluator::quit()
+{
+    mutex.lock();
+    quitNow = true;
+    wakeCond.wakeAll();
+    mutex.unlock();
+}
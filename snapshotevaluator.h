@@ -0,0 +1,51 @@
+#ifndef SNAPSHOTEVALUATOR_H
+#define SNAPSHOTEVALUATOR_H
+
+#include <vector>
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QHash>
+
+class FFNetwork;
+
+/**
+  * Background thread that, every interval, evaluates the latest weight
+  * snapshot of each registered network on the dataset with a clean full
+  * pass (no weights change during it). It only reads the snapshots, so it
+  * never takes a network's mutex or slows its training. Results are kept
+  * per network and read with result().
+  */
+class SnapshotEvaluator : public QThread
+{
+public:
+    SnapshotEvaluator();
+
+    void setDataset(const std::vector<std::vector<double> > &_inputs,
+                    const std::vector<std::vector<double> > &_expected);
+    void setInterval(int msecs);
+    void add(FFNetwork *network);
+    void remove(FFNetwork *network);
+    bool result(FFNetwork *network, unsigned int &epoch, double &error);
+    void run();
+    void quit();
+
+private:
+    struct Result
+    {
+        bool valid;
+        unsigned int epoch;
+        double error;
+    };
+
+    std::vector<std::vector<double> > inputs;
+    std::vector<std::vector<double> > expected;
+    int interval;
+    QHash<FFNetwork*, Result> results;
+    QMutex mutex;
+    QWaitCondition wakeCond;
+    bool quitNow;
+};
+
+#endif // SNAPSHOTEVALUATOR_H
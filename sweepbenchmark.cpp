@@ -0,0 +1,332 @@
+#include <iostream>
+using namespace std;
+
+#include <QEventLoop>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QFile>
+#include <QTextStream>
+#include <QStringList>
+
+#include <qwt_plot.h>
+
+#ifdef Q_OS_LINUX
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#include "sweepbenchmark.h"
+#include "networkmanager.h"
+#include "config.h"
+
+// the standard sweeps: the 4-4-1 parity sweep and two wider majority
+// functions (parity of more bits hardly converges with bits hidden units),
+// every one finishing within seconds per network
+const SweepBenchmark::Sweep SweepBenchmark::sweeps[] = {
+    { "parity4", Dataset::Parity, 4, 4, 0.2, 0.5, 0.1, 0.9, 0.05, 4 },
+    { "majority7", Dataset::Majority, 7, 7, 0.1, 0.3, 0.1, 0.9, 0.05, 2 },
+    { "majority9", Dataset::Majority, 9, 9, 0.05, 0.2, 0.05, 0.9, 0.5, 2 }
+};
+
+// a sweep still running after this long has hung or stopped converging
+const int SweepBenchmark::TimeLimitMsecs = 600000;
+
+// the scheduler overhead is small enough to be noisy; it only counts as a
+// regression if it also grew by this much
+const double SweepBenchmark::OverheadSlackSeconds = 0.05;
+
+// the allocator keeps or returns freed pages as it likes, so the RSS
+// growth only counts as a regression if it also grew by this much
+const qint64 SweepBenchmark::RssSlackKiB = 1024;
+
+SweepBenchmark::SweepBenchmark(const QString &_baselineFile, double _tolerance)
+    : baselineFile(_baselineFile), tolerance(_tolerance)
+{
+}
+
+/**
+  * Runs every standard sweep and either compares the results with the
+  * baseline or, with record, writes them as the new baseline. Returns the
+  * process exit status: 0 if all is well, 1 for a regression, 2 if a sweep
+  * did not finish or the baseline could not be read or written.
+  */
+int SweepBenchmark::run(bool record)
+{
+    QVector<Result> baseline;
+    if(!record && !readBaseline(baseline))
+    {
+        cerr << "cannot read baseline " << baselineFile.toAscii().data()
+             << " (run with --record to create it)" << endl;
+        return 2;
+    }
+
+    // one manager and config for all sweeps; a new dataset replaces every
+    // network of the previous sweep
+    Config config;
+    config.setCacheFile(QString());
+    QwtPlot plot;
+    NetworkManager manager(&plot);
+
+    QVector<Result> results;
+    bool regressed = false;
+    int numSweeps = sizeof(sweeps) / sizeof(sweeps[0]);
+    for(int s = 0; s < numSweeps; s++)
+    {
+        Result result;
+        if(!measure(sweeps[s], manager, config, result))
+        {
+            cerr << sweeps[s].name << ": did not finish within "
+                 << TimeLimitMsecs / 1000 << " s" << endl;
+            return 2;
+        }
+        cout << (QString("%1: %2 s, %3 epochs/s per busy core, RSS +%4 KiB, scheduler %5 s (%6%)")
+                 .arg(result.name).arg(result.wallSeconds, 0, 'f', 2)
+                 .arg(result.epochsPerCoreSecond, 0, 'f', 0).arg(result.rssGrowth)
+                 .arg(result.overheadSeconds, 0, 'f', 3)
+                 .arg(100.0 * result.overheadSeconds / result.wallSeconds, 0, 'f', 1)
+                 .toAscii().data()) << endl;
+        results << result;
+
+        if(record)
+            continue;
+        bool found = false;
+        for(int b = 0; b < baseline.size(); b++)
+        {
+            if(baseline[b].name != result.name) continue;
+            regressed |= !compare(result, baseline[b]);
+            found = true;
+        }
+        if(!found)
+            cout << result.name.toAscii().data() << ": not in the baseline" << endl;
+    }
+
+    if(record)
+    {
+        if(!writeBaseline(results))
+        {
+            cerr << "cannot write baseline " << baselineFile.toAscii().data() << endl;
+            return 2;
+        }
+        cout << "baseline written to " << baselineFile.toAscii().data() << endl;
+        return 0;
+    }
+    cout << (regressed ? "regression beyond " : "no regression beyond ")
+         << tolerance * 100.0 << "%" << endl;
+    return regressed ? 1 : 0;
+}
+
+/**
+  * Trains every standard sweep with one worker per network, then with the
+  * given number of workers Hogwild and synchronously, and prints how many
+  * networks converged, their mean epochs to converge and the wall time of
+  * each. Parallel training changes the updates, so its speedup in wall
+  * time only counts if it outweighs the extra epochs it may need. Returns
+  * 0, or 2 if a sweep did not finish.
+  */
+int SweepBenchmark::compareWorkers(unsigned int workers)
+{
+    Config config;
+    config.setCacheFile(QString());
+    QwtPlot plot;
+    NetworkManager manager(&plot);
+
+    cout << (QString("%1 %2 %3 %4 %5 %6 %7").arg("sweep", -10).arg("mode", -12)
+             .arg("workers", 7).arg("converged", 10).arg("mean epochs", 12)
+             .arg("wall s", 8).arg("speedup", 8).toAscii().data()) << endl;
+    int numSweeps = sizeof(sweeps) / sizeof(sweeps[0]);
+    for(int s = 0; s < numSweeps; s++)
+    {
+        double sequentialSeconds = 0.0;
+        // sequential first, then Hogwild and synchronous
+        for(int m = 0; m < 3; m++)
+        {
+            unsigned int w = (m == 0) ? 1 : workers;
+            FFNetwork::Parallelism mode = (m == 2) ? FFNetwork::Synchronous : FFNetwork::Hogwild;
+            config.setParallelism(mode, w);
+            Result result;
+            if(!measure(sweeps[s], manager, config, result))
+            {
+                cerr << sweeps[s].name << ": did not finish within "
+                     << TimeLimitMsecs / 1000 << " s" << endl;
+                return 2;
+            }
+            if(m == 0)
+                sequentialSeconds = result.wallSeconds;
+            QString name = (m == 0) ? QString("sequential")
+                           : (m == 1) ? QString("Hogwild") : QString("synchronous");
+            cout << (QString("%1 %2 %3 %4 %5 %6 %7").arg(result.name, -10).arg(name, -12)
+                     .arg(w, 7)
+                     .arg(QString("%1/%2").arg(result.converged).arg(result.networks), 10)
+                     .arg(result.meanEpochs, 12, 'f', 0).arg(result.wallSeconds, 8, 'f', 2)
+                     .arg(QString("%1x").arg(sequentialSeconds / result.wallSeconds, 0, 'f', 2), 8)
+                     .toAscii().data()) << endl;
+        }
+    }
+    return 0;
+}
+
+/**
+  * Trains one sweep from scratch until the manager stops; false if it ran
+  * into the time limit.
+  */
+bool SweepBenchmark::measure(const Sweep &sweep, NetworkManager &manager, Config &config,
+                             Result &result)
+{
+    // before the previous sweep's networks are replaced
+    qint64 rssStart = currentRss();
+    config.setSweep(sweep.etaStart, sweep.etaEnd, sweep.etaIncrement,
+                    sweep.momentum, sweep.stop, sweep.hidden, sweep.averaged);
+    manager.setDataset(new Dataset(sweep.task, sweep.bits));
+    manager.networksFromConfig(&config);
+
+    QEventLoop loop;
+    QTimer limit;
+    limit.setSingleShot(true);
+    QObject::connect(&manager, SIGNAL(stopped()), &loop, SLOT(quit()));
+    QObject::connect(&limit, SIGNAL(timeout()), &loop, SLOT(quit()));
+
+    // resume() is only called from the loop, so stopped() cannot be
+    // emitted before the loop runs
+    QElapsedTimer wall;
+    double cpuStart = mainThreadSeconds();
+    wall.start();
+    limit.start(TimeLimitMsecs);
+    QTimer::singleShot(0, &manager, SLOT(resume()));
+    loop.exec();
+    double wallSeconds = wall.nsecsElapsed() / 1e9;
+    double overhead = mainThreadSeconds() - cpuStart;
+
+    QObject::disconnect(&manager, SIGNAL(stopped()), &loop, SLOT(quit()));
+    if(!limit.isActive())
+    {
+        manager.pause();
+        return false;
+    }
+
+    result.name = sweep.name;
+    result.wallSeconds = wallSeconds;
+    // only the cores the sweep can keep busy count, one per worker of
+    // every network, so the figure does not depend on how many more the
+    // machine has
+    int cores = qMin(QThread::idealThreadCount(),
+                     manager.getNetworks().size() * int(config.getWorkers()));
+    result.epochsPerCoreSecond = double(manager.trainedEpochs()) / wallSeconds / qMax(cores, 1);
+    result.rssGrowth = qMax(currentRss() - rssStart, Q_INT64_C(0));
+    result.overheadSeconds = overhead;
+    result.networks = manager.getNetworks().size();
+    result.meanEpochs = manager.meanFinalEpoch(result.converged);
+    return true;
+}
+
+bool SweepBenchmark::readBaseline(QVector<Result> &baseline) const
+{
+    QFile file(baselineFile);
+    if(!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+    QTextStream in(&file);
+    while(!in.atEnd())
+    {
+        QString line = in.readLine().trimmed();
+        if(line.isEmpty() || line.startsWith('#'))
+            continue;
+        QStringList fields = line.split(' ', QString::SkipEmptyParts);
+        if(fields.size() != 5)
+            return false;
+        Result base;
+        base.name = fields[0];
+        base.wallSeconds = fields[1].toDouble();
+        base.epochsPerCoreSecond = fields[2].toDouble();
+        base.rssGrowth = fields[3].toLongLong();
+        base.overheadSeconds = fields[4].toDouble();
+        baseline << base;
+    }
+    return true;
+}
+
+bool SweepBenchmark::writeBaseline(const QVector<Result> &results) const
+{
+    QFile file(baselineFile);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+        return false;
+    QTextStream out(&file);
+    out << "# sweep benchmark baseline, " << QThread::idealThreadCount() << " cores\n";
+    out << "# name wallSeconds epochsPerCoreSecond rssGrowthKiB overheadSeconds\n";
+    for(int r = 0; r < results.size(); r++)
+    {
+        out << results[r].name << ' ' << QString::number(results[r].wallSeconds, 'f', 3)
+            << ' ' << QString::number(results[r].epochsPerCoreSecond, 'f', 0)
+            << ' ' << results[r].rssGrowth
+            << ' ' << QString::number(results[r].overheadSeconds, 'f', 3) << '\n';
+    }
+    return true;
+}
+
+/**
+  * Prints every measure of result that is worse than base by more than the
+  * tolerance; true if there is none.
+  */
+bool SweepBenchmark::compare(const Result &result, const Result &base) const
+{
+    bool ok = true;
+    ok &= !isWorse("wall time", result.wallSeconds, base.wallSeconds, false, 0.0, result.name);
+    ok &= !isWorse("epochs/s per busy core", result.epochsPerCoreSecond, base.epochsPerCoreSecond,
+                   true, 0.0, result.name);
+    ok &= !isWorse("RSS growth", double(result.rssGrowth), double(base.rssGrowth), false,
+                   double(RssSlackKiB), result.name);
+    ok &= !isWorse("scheduler overhead", result.overheadSeconds, base.overheadSeconds, false,
+                   OverheadSlackSeconds, result.name);
+    return ok;
+}
+
+bool SweepBenchmark::isWorse(const char *what, double value, double base, bool higherIsBetter,
+                             double slack, const QString &name) const
+{
+    bool worse = higherIsBetter ? value < base * (1.0 - tolerance)
+                                : value > base * (1.0 + tolerance) && value > base + slack;
+    if(worse)
+    {
+        double change = base > 0.0 ? 100.0 * (value - base) / base : 0.0;
+        cout << (QString("%1: %2 %3 against %4 in the baseline (%5%6%) - regression")
+                 .arg(name).arg(what).arg(value).arg(base)
+                 .arg(change >= 0.0 ? "+" : "").arg(change, 0, 'f', 1)
+                 .toAscii().data()) << endl;
+    }
+    return worse;
+}
+
+/**
+  * Current resident set size of the process in KiB (0 where unknown).
+  * Unlike the peak from getrusage(), which never goes down, this can be
+  * compared before and after each sweep.
+  */
+qint64 SweepBenchmark::currentRss()
+{
+#ifdef Q_OS_LINUX
+    QFile statm("/proc/self/statm");
+    if(statm.open(QIODevice::ReadOnly))
+    {
+        // size resident shared text lib data dt, in pages
+        QStringList fields = QString(statm.readAll()).split(' ', QString::SkipEmptyParts);
+        if(fields.size() > 1)
+            return fields[1].toLongLong() * sysconf(_SC_PAGESIZE) / 1024;
+    }
+#endif
+    return 0;
+}
+
+/**
+  * CPU time used by the calling thread in seconds (0 where unknown).
+  */
+double SweepBenchmark::mainThreadSeconds()
+{
+#ifdef Q_OS_LINUX
+    struct rusage usage;
+    if(getrusage(RUSAGE_THREAD, &usage) == 0)
+    {
+        return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec
+               + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+    }
+#endif
+    return 0.0;
+}
@@ -0,0 +1,89 @@
+#ifndef SWEEPBENCHMARK_H
+#define SWEEPBENCHMARK_H
+
+#include <QString>
+#include <QVector>
+
+#include "dataset.h"
+
+class NetworkManager;
+class Config;
+
+/**
+  * Runs a fixed set of standard sweeps end to end through NetworkManager
+  * (networksFromConfig, resume, every final epoch, stopped()) without
+  * showing a window, and compares their performance with a baseline file.
+  * Every run is seeded the same way, so the epochs trained only change with
+  * the training code; what is measured is how fast they are trained.
+  *
+  * Per sweep it records the wall time from resume() to stopped(), the
+  * epochs trained per second per busy core (at most one per worker of
+  * every network), how much the process's RSS grew from the start of the
+  * sweep to its end (its networks are still allocated then; memory freed
+  * from the previous sweep counts as no growth) and the scheduler
+  * overhead, the CPU time of the main thread (which runs every manager
+  * slot, the plotting and the event dispatch). A sweep is a regression if
+  * any of them is worse than its baseline by more than the tolerance.
+  *
+  * The baseline is a text file with one line per sweep:
+  *   name wallSeconds epochsPerCoreSecond rssGrowthKiB overheadSeconds
+  * and '#' comment lines. It is only written when asked to (record), from
+  * a run on the machine it is meant for.
+  *
+  * compareWorkers() instead trains every sweep sequentially and with
+  * several workers per network, and prints the epochs to converge and the
+  * wall time of each side by side.
+  */
+class SweepBenchmark
+{
+public:
+    SweepBenchmark(const QString &_baselineFile, double _tolerance);
+    int run(bool record);
+    int compareWorkers(unsigned int workers);
+
+private:
+    struct Sweep
+    {
+        const char *name;
+        Dataset::Task task;
+        unsigned int bits;
+        unsigned int hidden;
+        double etaStart;
+        double etaEnd;
+        double etaIncrement;
+        double momentum;
+        double stop;
+        unsigned int averaged;
+    };
+
+    struct Result
+    {
+        QString name;
+        double wallSeconds;
+        double epochsPerCoreSecond;
+        qint64 rssGrowth;
+        double overheadSeconds;
+        int networks;
+        int converged;
+        double meanEpochs;
+    };
+
+    static const Sweep sweeps[];
+    static const int TimeLimitMsecs;
+    static const double OverheadSlackSeconds;
+    static const qint64 RssSlackKiB;
+
+    QString baselineFile;
+    double tolerance;
+
+    bool measure(const Sweep &sweep, NetworkManager &manager, Config &config, Result &result);
+    bool readBaseline(QVector<Result> &baseline) const;
+    bool writeBaseline(const QVector<Result> &results) const;
+    bool compare(const Result &result, const Result &base) const;
+    bool isWorse(const char *what, double value, double base, bool higherIsBetter,
+                 double slack, const QString &name) const;
+    static qint64 currentRss();
+    static double mainThreadSeconds();
+};
+
+#endif // SWEEPBENCHMARK_H
@@ -0,0 +1,229 @@
+#include <cmath>
+
+#include "telemetrywriter.h"
+
+namespace
+{
+    const quint32 FileMagic = 0x4e4e544c;
+    const quint32 FileVersion = 1;
+    const quint32 DescriptorMagic = 0x4e4e5444;
+    const quint32 DataMagic = 0x4e4e5442;
+
+    // how long the writer sleeps between drains; with Capacity records per
+    // ring, a network can record this many epochs per second before any
+    // are dropped: Capacity * 1000 / DrainInterval
+    const unsigned long DrainInterval = 20;
+
+    quint64 padded(quint64 bytes)
+    {
+        return (bytes + 7) & ~quint64(7);
+    }
+}
+
+TelemetryChannel::TelemetryChannel(quint32 _number, unsigned int _layerCount,
+                                   const QElapsedTimer *_clock)
+    : number(_number), layerCount(_layerCount), clock(_clock)
+{
+    times = new qint64[Capacity];
+    epochs = new quint32[Capacity];
+    errors = new float[Capacity];
+    norms = new float[Capacity * layerCount];
+}
+
+TelemetryChannel::~TelemetryChannel()
+{
+    delete[] times;
+    delete[] epochs;
+    delete[] errors;
+    delete[] norms;
+}
+
+/**
+  * Records one epoch; normSquares holds the squared gradient norm of each
+  * weight layer. Called from the network's training thread only.
+  */
+void TelemetryChannel::record(unsigned int epoch, double error, const double *normSquares)
+{
+    int h = head;
+    if(h - tail.fetchAndAddAcquire(0) >= int(Capacity))
+    {
+        dropped.fetchAndAddRelaxed(1);
+        return;
+    }
+    int slot = h & (Capacity - 1);
+    times[slot] = clock->nsecsElapsed();
+    epochs[slot] = epoch;
+    errors[slot] = float(error);
+    for(unsigned int i = 0; i < layerCount; i++)
+        norms[i*Capacity + slot] = float(sqrt(normSquares[i]));
+    head.fetchAndStoreRelease(h + 1);
+}
+
+/**
+  * Hands the channel back to the writer, which writes out what is left
+  * and frees it. Nothing may be recorded afterwards.
+  */
+void TelemetryChannel::retire()
+{
+    retired.fetchAndStoreRelease(1);
+}
+
+TelemetryWriter::TelemetryWriter(const QString &_fileName)
+    : name(_fileName), nextChannel(0), quitNow(false)
+{
+    file.setFileName(name);
+    if(file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        file.write((const char*)&FileMagic, sizeof(FileMagic));
+        file.write((const char*)&FileVersion, sizeof(FileVersion));
+    }
+    clock.start();
+}
+
+/**
+  * Writes out everything recorded and closes the file. Every channel must
+  * have been retired by then.
+  */
+TelemetryWriter::~TelemetryWriter()
+{
+    mutex.lock();
+    quitNow = true;
+    wakeCond.wakeAll();
+    mutex.unlock();
+    wait();
+
+    for(int c = 0; c < channels.size(); c++)
+        delete channels[c];
+    if(file.isOpen())
+        file.close();
+}
+
+bool TelemetryWriter::isOpen() const
+{
+    return file.isOpen();
+}
+
+QString TelemetryWriter::fileName() const
+{
+    return name;
+}
+
+/**
+  * Opens a channel for one run of a network and writes its descriptor;
+  * NULL if the file could not be opened.
+  */
+TelemetryChannel *TelemetryWriter::open(const std::vector<unsigned int> &layers, double eta,
+                                        double momentum, int avgId, quint32 seed)
+{
+    if(!file.isOpen())
+        return NULL;
+
+    mutex.lock();
+    TelemetryChannel *channel = new TelemetryChannel(nextChannel++, layers.size() - 1, &clock);
+    channels << channel;
+
+    quint64 payload = 2*sizeof(double) + 3*sizeof(quint32) + layers.size()*sizeof(quint32);
+    writeHeader(DescriptorMagic, channel->number, 16 + padded(payload));
+    qint32 avg = avgId;
+    quint32 layerCount = layers.size();
+    file.write((const char*)&eta, sizeof(eta));
+    file.write((const char*)&momentum, sizeof(momentum));
+    file.write((const char*)&avg, sizeof(avg));
+    file.write((const char*)&seed, sizeof(seed));
+    file.write((const char*)&layerCount, sizeof(layerCount));
+    for(unsigned int i = 0; i < layers.size(); i++)
+    {
+        quint32 size = layers[i];
+        file.write((const char*)&size, sizeof(size));
+    }
+    pad(payload);
+    mutex.unlock();
+    return channel;
+}
+
+void TelemetryWriter::run()
+{
+    mutex.lock();
+    while(!quitNow)
+    {
+        wakeCond.wait(&mutex, DrainInterval);
+        flush();
+    }
+    flush();
+    mutex.unlock();
+}
+
+/**
+  * Writes one data block per channel with new records (or drops) and frees
+  * retired channels once they are drained; called with the mutex held.
+  */
+void TelemetryWriter::flush()
+{
+    if(!file.isOpen())
+        return;
+
+    for(int c = 0; c < channels.size(); c++)
+    {
+        TelemetryChannel *channel = channels[c];
+        bool retired = channel->retired.fetchAndAddAcquire(0) != 0;
+        int head = channel->head.fetchAndAddAcquire(0);
+        int tail = channel->tail;
+        int count = head - tail;
+        quint32 dropped = channel->dropped.fetchAndStoreRelaxed(0);
+
+        if(count > 0 || dropped > 0)
+        {
+            quint32 layerCount = channel->layerCount;
+            quint64 size = 16 + 16 + padded(count*sizeof(qint64)) + padded(count*sizeof(quint32))
+                           + (1 + layerCount) * padded(count*sizeof(float));
+            writeHeader(DataMagic, channel->number, size);
+            quint32 counts[4] = {quint32(count), dropped, layerCount, 0};
+            file.write((const char*)counts, sizeof(counts));
+
+            int first = tail & (TelemetryChannel::Capacity - 1);
+            writeColumn((const char*)channel->times, sizeof(qint64), first, count);
+            writeColumn((const char*)channel->epochs, sizeof(quint32), first, count);
+            writeColumn((const char*)channel->errors, sizeof(float), first, count);
+            for(unsigned int i = 0; i < layerCount; i++)
+            {
+                writeColumn((const char*)(channel->norms + i*TelemetryChannel::Capacity),
+                            sizeof(float), first, count);
+            }
+            channel->tail.fetchAndStoreRelease(head);
+        }
+
+        if(retired)
+        {
+            channels.removeAt(c--);
+            delete channel;
+        }
+    }
+    file.flush();
+}
+
+void TelemetryWriter::writeHeader(quint32 magic, quint32 channel, quint64 size)
+{
+    file.write((const char*)&magic, sizeof(magic));
+    file.write((const char*)&channel, sizeof(channel));
+    file.write((const char*)&size, sizeof(size));
+}
+
+/**
+  * Writes count entries of a ring column starting at slot first, wrapping
+  * around the end of the ring, padded to 8 bytes.
+  */
+void TelemetryWriter::writeColumn(const char *ring, int elementSize, int first, int count)
+{
+    int toEnd = qMin(count, int(TelemetryChannel::Capacity) - first);
+    file.write(ring + first*elementSize, toEnd*elementSize);
+    if(count > toEnd)
+        file.write(ring, (count - toEnd)*elementSize);
+    pad(qint64(count)*elementSize);
+}
+
+void TelemetryWriter::pad(qint64 bytes)
+{
+    static const char zeros[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    if(bytes % 8 != 0)
+        file.write(zeros, 8 - bytes % 8);
+}
@@ -0,0 +1,100 @@
+#ifndef TELEMETRYWRITER_H
+#define TELEMETRYWRITER_H
+
+#include <vector>
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QList>
+#include <QString>
+
+/**
+  * The telemetry stream of one network run: a ring of per-epoch records
+  * (wall-clock time, epoch, error and the gradient norm of every weight
+  * layer) with a single producer, the network's training thread, and a
+  * single consumer, the writer. The ring is stored column by column so it
+  * is written out without reshuffling. record() never locks or waits; when
+  * the ring is full the record is dropped and counted.
+  */
+class TelemetryChannel
+{
+public:
+    void record(unsigned int epoch, double error, const double *normSquares);
+    void retire();
+
+private:
+    friend class TelemetryWriter;
+    enum { Capacity = 16384 };
+
+    TelemetryChannel(quint32 _number, unsigned int _layerCount, const QElapsedTimer *_clock);
+    ~TelemetryChannel();
+
+    quint32 number;
+    unsigned int layerCount;
+    const QElapsedTimer *clock;
+    qint64 *times;
+    quint32 *epochs;
+    float *errors;
+    // one column of Capacity entries per weight layer
+    float *norms;
+    // head and tail only ever increase and are masked on use
+    QAtomicInt head;
+    QAtomicInt tail;
+    QAtomicInt dropped;
+    QAtomicInt retired;
+};
+
+/**
+  * Background thread that drains the telemetry channels of all networks
+  * into one binary file every few milliseconds.
+  *
+  * The file holds native-endian data (the magic numbers give the byte
+  * order away). It starts with the quint32 magic 0x4e4e544c and the
+  * quint32 version 1, followed by blocks that each start with a quint32
+  * magic, the quint32 channel number and the quint64 size of the whole
+  * block in bytes. Every block is a multiple of 8 bytes long, so every
+  * column starts 8-byte aligned and the file can be memory-mapped and read
+  * in place.
+  *
+  * Descriptor block (magic 0x4e4e5444), one per channel, written when the
+  * channel is opened: double eta, double momentum, qint32 avgId,
+  * quint32 seed, quint32 layer count and quint32 layer sizes.
+  *
+  * Data block (magic 0x4e4e5442): quint32 record count n, quint32 records
+  * dropped since the previous block, quint32 number of weight layers L,
+  * quint32 0; then the columns, each padded to 8 bytes: qint64 time[n]
+  * (nanoseconds since the file was opened), quint32 epoch[n], float
+  * error[n] and L columns of float gradient norm[n].
+  */
+class TelemetryWriter : public QThread
+{
+public:
+    TelemetryWriter(const QString &_fileName);
+    ~TelemetryWriter();
+    bool isOpen() const;
+    QString fileName() const;
+    TelemetryChannel *open(const std::vector<unsigned int> &layers, double eta,
+                           double momentum, int avgId, quint32 seed);
+    void run();
+
+private:
+    QString name;
+    QFile file;
+    QElapsedTimer clock;
+    QMutex mutex;
+    QWaitCondition wakeCond;
+    QList<TelemetryChannel*> channels;
+    quint32 nextChannel;
+    bool quitNow;
+
+    void flush();
+    void writeHeader(quint32 magic, quint32 channel, quint64 size);
+    void writeColumn(const char *ring, int elementSize, int first, int count);
+    void pad(qint64 bytes);
+};
+
+#endif // TELEMETRYWRITER_H
@@ -0,0 +1,136 @@
+#include <QtTest>
+#include <QDir>
+#include <QFile>
+#include <QDataStream>
+
+#include "resultcache.h"
+
+class TestResultCache : public QObject
+{
+    Q_OBJECT
+
+private:
+    QString path;
+
+    static ResultCache::Entry entry(int final);
+    static bool has(ResultCache &cache, const char *signature, int final);
+    void truncate(qint64 bytes);
+
+private slots:
+    void init();
+    void cleanup();
+    void storeAndReload();
+    void tornRecordIsCutOff();
+    void otherVersionIsStartedOver();
+};
+
+ResultCache::Entry TestResultCache::entry(int final)
+{
+    ResultCache::Entry e;
+    e.final = final;
+    for(int i = 0; i < 4; i++)
+    {
+        e.epochs << 100.0*i;
+        e.errors << 1.0/(i+1);
+    }
+    return e;
+}
+
+/**
+  * Whether the cache holds the entry made by entry(final) for signature.
+  */
+bool TestResultCache::has(ResultCache &cache, const char *signature, int final)
+{
+    ResultCache::Entry e;
+    if(!cache.lookup(QByteArray(signature), e))
+        return false;
+    ResultCache::Entry expected = entry(final);
+    return e.final == final && e.epochs == expected.epochs && e.errors == expected.errors;
+}
+
+/**
+  * Cuts the last bytes off the cache file, as a crash while appending
+  * would.
+  */
+void TestResultCache::truncate(qint64 bytes)
+{
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QVERIFY(file.resize(file.size() - bytes));
+    file.close();
+}
+
+void TestResultCache::init()
+{
+    path = QDir(QDir::tempPath()).filePath("tst_resultcache.bin");
+    QFile::remove(path);
+}
+
+void TestResultCache::cleanup()
+{
+    QFile::remove(path);
+}
+
+void TestResultCache::storeAndReload()
+{
+    {
+        ResultCache cache(path);
+        QVERIFY(!has(cache, "a", 10));
+        cache.store(QByteArray("a"), entry(10));
+        cache.store(QByteArray("b"), entry(20));
+        QVERIFY(has(cache, "a", 10));
+    }
+    ResultCache cache(path);
+    QVERIFY(has(cache, "a", 10));
+    QVERIFY(has(cache, "b", 20));
+    QVERIFY(!has(cache, "c", 30));
+}
+
+/**
+  * A record cut short must be dropped on the next open, and a record
+  * appended afterwards must still be readable by the open after that.
+  */
+void TestResultCache::tornRecordIsCutOff()
+{
+    {
+        ResultCache cache(path);
+        cache.store(QByteArray("a"), entry(10));
+        cache.store(QByteArray("b"), entry(20));
+    }
+    truncate(5);
+    {
+        ResultCache cache(path);
+        QVERIFY(has(cache, "a", 10));
+        QVERIFY(!has(cache, "b", 20));
+        cache.store(QByteArray("c"), entry(30));
+    }
+    ResultCache cache(path);
+    QVERIFY(has(cache, "a", 10));
+    QVERIFY(!has(cache, "b", 20));
+    QVERIFY(has(cache, "c", 30));
+}
+
+/**
+  * A file with another header is not read, and is replaced by one that
+  * the next open can read.
+  */
+void TestResultCache::otherVersionIsStartedOver()
+{
+    {
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        QDataStream out(&file);
+        out.setVersion(QDataStream::Qt_4_6);
+        out << quint32(0x4e4e5243) << quint32(0) << quint64(1) << qint32(7);
+        file.close();
+    }
+    {
+        ResultCache cache(path);
+        cache.store(QByteArray("a"), entry(10));
+    }
+    ResultCache cache(path);
+    QVERIFY(has(cache, "a", 10));
+}
+
+QTEST_APPLESS_MAIN(TestResultCache)
+#include "tst_resultcache.moc"
@@ -0,0 +1,13 @@
+# -------------------------------------------------
+# Unit test of ResultCache: qmake && make && ./tst_resultcache
+# -------------------------------------------------
+QT += testlib
+QT -= gui
+CONFIG += console
+CONFIG -= app_bundle
+TARGET = tst_resultcache
+TEMPLATE = app
+INCLUDEPATH += ../..
+SOURCES += tst_resultcache.cpp \
+    ../../resultcache.cpp
+HEADERS += ../../resultcache.h
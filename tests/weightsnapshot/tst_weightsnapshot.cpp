@@ -0,0 +1,147 @@
+#include <vector>
+using namespace std;
+
+#include <QtTest>
+#include <QThread>
+
+#include "weightsnapshot.h"
+
+/**
+  * Publishes snapshots whose every weight is the snapshot's epoch, so a
+  * reader can tell a torn copy from a whole one.
+  */
+class Publisher : public QThread
+{
+public:
+    Publisher(WeightSnapshot *_snapshot, unsigned int _count)
+        : snapshot(_snapshot), count(_count) {}
+
+    void run()
+    {
+        for(unsigned int epoch = 1; epoch <= count; epoch++)
+        {
+            double *weights = snapshot->beginWrite();
+            for(unsigned int n = 0; n < snapshot->size(); n++)
+                weights[n] = double(epoch);
+            snapshot->endWrite(epoch);
+        }
+    }
+
+private:
+    WeightSnapshot *snapshot;
+    unsigned int count;
+};
+
+class TestWeightSnapshot : public QObject
+{
+    Q_OBJECT
+
+private:
+    static vector<unsigned int> layers(unsigned int inputs, unsigned int hidden,
+                                       unsigned int outputs);
+
+private slots:
+    void readBeforePublish();
+    void readLatest();
+    void forwardMatchesActivations();
+    void concurrentReadsAreWhole();
+};
+
+vector<unsigned int> TestWeightSnapshot::layers(unsigned int inputs, unsigned int hidden,
+                                                unsigned int outputs)
+{
+    vector<unsigned int> sizes;
+    sizes.push_back(inputs);
+    sizes.push_back(hidden);
+    sizes.push_back(outputs);
+    return sizes;
+}
+
+void TestWeightSnapshot::readBeforePublish()
+{
+    WeightSnapshot snapshot(layers(4, 4, 1));
+    vector<double> weights;
+    unsigned int epoch;
+    QVERIFY(!snapshot.read(weights, epoch));
+}
+
+void TestWeightSnapshot::readLatest()
+{
+    WeightSnapshot snapshot(layers(4, 4, 1));
+    QCOMPARE(snapshot.size(), 25u);
+    for(unsigned int e = 1; e <= 3; e++)
+    {
+        double *w = snapshot.beginWrite();
+        for(unsigned int n = 0; n < snapshot.size(); n++)
+            w[n] = e + 0.001*n;
+        snapshot.endWrite(e*10);
+    }
+
+    vector<double> weights;
+    unsigned int epoch;
+    QVERIFY(snapshot.read(weights, epoch));
+    QCOMPARE(epoch, 30u);
+    QCOMPARE(weights.size(), size_t(25));
+    for(unsigned int n = 0; n < weights.size(); n++)
+        QCOMPARE(weights[n], 3 + 0.001*n);
+}
+
+void TestWeightSnapshot::forwardMatchesActivations()
+{
+    WeightSnapshot snapshot(layers(3, 2, 1));
+    vector<double> weights(snapshot.size());
+    for(unsigned int n = 0; n < weights.size(); n++)
+        weights[n] = 0.1*n - 0.5;
+    vector<double> input(3, 1.0);
+    input[1] = 0.0;
+
+    vector<vector<double> > vals = snapshot.activations(weights, input);
+    QCOMPARE(vals.size(), size_t(3));
+    QVERIFY(vals[0] == input);
+    QCOMPARE(vals[1].size(), size_t(2));
+    QVERIFY(vals[2] == snapshot.forward(weights, input));
+}
+
+/**
+  * A reader copying snapshots while the writer keeps publishing must only
+  * ever see whole snapshots, of epochs that never go back.
+  */
+void TestWeightSnapshot::concurrentReadsAreWhole()
+{
+    // 40-40-1, 1681 weights
+    const unsigned int publishes = 2000000;
+    WeightSnapshot snapshot(layers(40, 40, 1));
+    Publisher publisher(&snapshot, publishes);
+
+    vector<double> weights;
+    unsigned int epoch;
+    unsigned int lastEpoch = 0;
+    unsigned int reads = 0;
+    unsigned int torn = 0;
+    publisher.start();
+    while(!publisher.isFinished())
+    {
+        if(!snapshot.read(weights, epoch))
+            continue;
+        reads++;
+        QVERIFY(epoch >= lastEpoch);
+        lastEpoch = epoch;
+        for(unsigned int n = 0; n < weights.size(); n++)
+        {
+            if(weights[n] != double(epoch))
+            {
+                torn++;
+                break;
+            }
+        }
+    }
+    publisher.wait();
+
+    QCOMPARE(torn, 0u);
+    QVERIFY(reads > 0);
+    QVERIFY(snapshot.read(weights, epoch));
+    QCOMPARE(epoch, publishes);
+}
+
+QTEST_APPLESS_MAIN(TestWeightSnapshot)
+#include "tst_weightsnapshot.moc"
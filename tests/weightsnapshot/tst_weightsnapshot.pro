@@ -0,0 +1,13 @@
+# -------------------------------------------------
+# Unit test of WeightSnapshot: qmake && make && ./tst_weightsnapshot
+# -------------------------------------------------
+QT += testlib
+QT -= gui
+CONFIG += console
+CONFIG -= app_bundle
+TARGET = tst_weightsnapshot
+TEMPLATE = app
+INCLUDEPATH += ../..
+SOURCES += tst_weightsnapshot.cpp \
+    ../../weightsnapshot.cpp
+HEADERS += ../../weightsnapshot.h
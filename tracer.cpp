@@ -0,0 +1,313 @@
+#include <QThread>
+#include <QThreadStorage>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+#include <QFile>
+#include <QTextStream>
+
+#include "tracer.h"
+
+namespace
+{
+    struct Event
+    {
+        const char *name;
+        char phase;
+        qint64 start;
+        qint64 duration;
+        int id;
+        int avgId;
+        int value;
+    };
+
+    // single-producer (the recording thread), single-consumer (the writer)
+    // ring; head and tail only ever increase and are masked on use. The
+    // recording thread and the writer of the session the ring is
+    // registered with each hold a reference; the last one frees it
+    struct Ring
+    {
+        enum { Capacity = 4096 };
+
+        Event events[Capacity];
+        QAtomicInt head;
+        QAtomicInt tail;
+        QAtomicInt dropped;
+        QAtomicInt retired;
+        QAtomicInt refs;
+        int session;
+        int tid;
+        QString threadName;
+        bool named;
+    };
+
+    // owned by the recording thread's QThreadStorage; retires its ring
+    // when the thread exits so the writer can drain and free it
+    struct RingHandle
+    {
+        Ring *ring;
+        ~RingHandle()
+        {
+            ring->retired.fetchAndStoreRelease(1);
+            if(!ring->refs.deref())
+                delete ring;
+        }
+    };
+
+    class TraceWriter : public QThread
+    {
+    public:
+        TraceWriter() : quitNow(false), first(true) {}
+        void run();
+        void flush();
+
+        QFile file;
+        QTextStream out;
+        QMutex mutex;
+        QWaitCondition wakeCond;
+        QList<Ring*> rings;
+        int nextTid;
+        bool quitNow;
+        bool first;
+    };
+
+    // writer is only replaced with sessionMutex held, so a thread that
+    // registers its ring never sees a writer being stopped; every start()
+    // begins a new session, and a ring left from an earlier one is
+    // registered again on its thread's next event
+    TraceWriter *writer = NULL;
+    QMutex sessionMutex;
+    QAtomicInt session(0);
+    QThreadStorage<RingHandle*> localRing;
+}
+
+QAtomicInt Tracer::enabled(0);
+QElapsedTimer Tracer::clock;
+
+void TraceWriter::run()
+{
+    mutex.lock();
+    while(!quitNow)
+    {
+        wakeCond.wait(&mutex, 100);
+        flush();
+    }
+    flush();
+    mutex.unlock();
+}
+
+/**
+  * Drains every ring to the file; called with the mutex held.
+  */
+void TraceWriter::flush()
+{
+    for(int r = 0; r < rings.size(); r++)
+    {
+        Ring *ring = rings[r];
+        if(!ring->named && !ring->threadName.isEmpty())
+        {
+            out << (first ? "\n" : ",\n")
+                << QString("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%1,"
+                           "\"args\":{\"name\":\"%2\"}}").arg(ring->tid).arg(ring->threadName);
+            first = false;
+            ring->named = true;
+        }
+
+        bool retired = ring->retired.fetchAndAddAcquire(0) != 0;
+        int head = ring->head.fetchAndAddAcquire(0);
+        int tail = ring->tail;
+        for(; tail != head; tail++)
+        {
+            const Event &e = ring->events[tail & (Ring::Capacity - 1)];
+            out << (first ? "\n" : ",\n");
+            first = false;
+            out << "{\"name\":\"" << e.name << "\",\"ph\":\"" << e.phase << "\",\"pid\":1,\"tid\":"
+                << ring->tid << ",\"ts\":" << QString::number(e.start / 1000.0, 'f', 3);
+            if(e.phase == 'X')
+                out << ",\"dur\":" << QString::number(e.duration / 1000.0, 'f', 3);
+            else
+                out << ",\"s\":\"t\"";
+            out << ",\"args\":{";
+            bool comma = false;
+            if(e.id >= 0)
+            {
+                out << "\"id\":" << e.id;
+                comma = true;
+            }
+            if(e.avgId >= 0)
+            {
+                out << (comma ? "," : "") << "\"avgId\":" << e.avgId;
+                comma = true;
+            }
+            if(e.value >= 0)
+            {
+                out << (comma ? "," : "") << "\"value\":" << e.value;
+            }
+            out << "}}";
+        }
+        ring->tail.fetchAndStoreRelease(tail);
+
+        int dropped = ring->dropped.fetchAndStoreRelaxed(0);
+        if(dropped > 0)
+        {
+            out << (first ? "\n" : ",\n")
+                << QString("{\"name\":\"events dropped\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,"
+                           "\"tid\":%1,\"ts\":%2,\"args\":{\"value\":%3}}")
+                   .arg(ring->tid).arg(Tracer::now() / 1000.0, 0, 'f', 3).arg(dropped);
+            first = false;
+        }
+
+        if(retired)
+        {
+            rings.removeAt(r--);
+            if(!ring->refs.deref())
+                delete ring;
+        }
+    }
+    out.flush();
+}
+
+/**
+  * Starts tracing to fileName; false if the file cannot be written.
+  */
+bool Tracer::start(const QString &fileName)
+{
+    QMutexLocker locker(&sessionMutex);
+    if(writer != NULL)
+        return false;
+
+    TraceWriter *w = new TraceWriter;
+    w->file.setFileName(fileName);
+    if(!w->file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        delete w;
+        return false;
+    }
+    w->out.setDevice(&w->file);
+    w->out << "{\"traceEvents\":[";
+    w->nextTid = 1;
+    writer = w;
+    session.fetchAndAddOrdered(1);
+    clock.start();
+    writer->start(QThread::LowPriority);
+    enabled.fetchAndStoreOrdered(1);
+    return true;
+}
+
+/**
+  * Stops tracing, writes out everything recorded and closes the file.
+  * Rings of threads that have exited are freed; those of threads still
+  * running stay with their threads, and tracing can be started again.
+  */
+void Tracer::stop()
+{
+    // held until the writer is gone, so no ring is registered again (and
+    // emptied) while the old writer may still drain it
+    QMutexLocker locker(&sessionMutex);
+    TraceWriter *w = writer;
+    if(w == NULL)
+        return;
+    writer = NULL;
+    enabled.fetchAndStoreOrdered(0);
+
+    w->mutex.lock();
+    w->quitNow = true;
+    w->wakeCond.wakeAll();
+    w->mutex.unlock();
+    w->wait();
+
+    w->out << "\n]}\n";
+    w->out.flush();
+    w->file.close();
+    for(int r = 0; r < w->rings.size(); r++)
+    {
+        if(!w->rings[r]->refs.deref())
+            delete w->rings[r];
+    }
+    delete w;
+}
+
+qint64 Tracer::now()
+{
+    return clock.nsecsElapsed();
+}
+
+void Tracer::complete(const char *name, qint64 start, int id, int avgId, int value)
+{
+    if(!isEnabled())
+        return;
+    record(name, 'X', start, now() - start, id, avgId, value);
+}
+
+void Tracer::instant(const char *name, int id, int avgId, int value)
+{
+    if(!isEnabled())
+        return;
+    record(name, 'i', now(), 0, id, avgId, value);
+}
+
+void Tracer::setThreadName(const QString &name)
+{
+    if(!isEnabled())
+        return;
+    // make sure the thread has its ring
+    record("thread start", 'i', now(), 0, -1, -1, -1);
+    if(!localRing.hasLocalData())
+        return;
+    QMutexLocker locker(&sessionMutex);
+    if(writer == NULL)
+        return;
+    writer->mutex.lock();
+    localRing.localData()->ring->threadName = name;
+    writer->mutex.unlock();
+}
+
+void Tracer::record(const char *name, char phase, qint64 start, qint64 duration,
+                    int id, int avgId, int value)
+{
+    if(!localRing.hasLocalData())
+    {
+        Ring *ring = new Ring;
+        ring->refs = 1;
+        ring->session = 0;
+        RingHandle *handle = new RingHandle;
+        handle->ring = ring;
+        localRing.setLocalData(handle);
+    }
+    Ring *ring = localRing.localData()->ring;
+
+    if(ring->session != int(session))
+    {
+        // first event of this session; the ring starts empty, and is only
+        // seen by the writer once registered
+        QMutexLocker locker(&sessionMutex);
+        if(writer == NULL)
+            return;
+        ring->head = 0;
+        ring->tail = 0;
+        ring->dropped = 0;
+        ring->named = false;
+        ring->session = int(session);
+        ring->refs.ref();
+        writer->mutex.lock();
+        ring->tid = writer->nextTid++;
+        writer->rings << ring;
+        writer->mutex.unlock();
+    }
+
+    int head = ring->head;
+    if(head - ring->tail.fetchAndAddAcquire(0) >= int(Ring::Capacity))
+    {
+        ring->dropped.fetchAndAddRelaxed(1);
+        return;
+    }
+    Event &e = ring->events[head & (Ring::Capacity - 1)];
+    e.name = name;
+    e.phase = phase;
+    e.start = start;
+    e.duration = duration;
+    e.id = id;
+    e.avgId = avgId;
+    e.value = value;
+    ring->head.fetchAndStoreRelease(head + 1);
+}
@@ -0,0 +1,64 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QString>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+
+/**
+  * Optional low-overhead event tracing, written as a Chrome trace
+  * (chrome://tracing, Perfetto) JSON file. When tracing is off every
+  * trace point costs one test of isEnabled(). Each thread records into its
+  * own fixed-size ring buffer without locking, and a background thread
+  * drains the rings to the file. When a ring is full its events are
+  * dropped and counted, never waited for.
+  *
+  * Event names must be string literals (only the pointer is stored).
+  * id, avgId and value are optional arguments shown with the event
+  * (-1 leaves them out).
+  */
+class Tracer
+{
+public:
+    static bool start(const QString &fileName);
+    static void stop();
+    static bool isEnabled() { return int(enabled) != 0; }
+
+    static qint64 now();
+    static void complete(const char *name, qint64 start,
+                         int id = -1, int avgId = -1, int value = -1);
+    static void instant(const char *name, int id = -1, int avgId = -1, int value = -1);
+    static void setThreadName(const QString &name);
+
+private:
+    static QAtomicInt enabled;
+    static QElapsedTimer clock;
+
+    static void record(const char *name, char phase, qint64 start, qint64 duration,
+                       int id, int avgId, int value);
+};
+
+/**
+  * Records a complete event spanning its own lifetime.
+  */
+class TraceSpan
+{
+public:
+    TraceSpan(const char *_name, int _id = -1, int _avgId = -1, int _value = -1)
+        : name(_name), id(_id), avgId(_avgId), value(_value),
+        start(Tracer::isEnabled() ? Tracer::now() : -1) {}
+    ~TraceSpan()
+    {
+        if(start >= 0)
+            Tracer::complete(name, start, id, avgId, value);
+    }
+
+private:
+    const char *name;
+    int id;
+    int avgId;
+    int value;
+    qint64 start;
+};
+
+#endif // TRACER_H
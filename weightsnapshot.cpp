@@ -0,0 +1,151 @@
+#include <vector>
+#include <cmath>
+using namespace std;
+
+#include "weightsnapshot.h"
+
+WeightSnapshot::WeightSnapshot(const vector<unsigned int> &_layers)
+    : layers(_layers), current(-1), writing(0)
+{
+    numWeights = 0;
+    for(unsigned int i = 1; i < layers.size(); i++)
+    {
+        numWeights += layers[i]*layers[i-1] + layers[i];
+    }
+    for(int b = 0; b < 2; b++)
+    {
+        buffers[b] = new double[numWeights];
+        epochs[b] = 0;
+    }
+}
+
+WeightSnapshot::~WeightSnapshot()
+{
+    delete[] buffers[0];
+    delete[] buffers[1];
+}
+
+/**
+  * Returns the buffer to fill with the next snapshot (writer thread only).
+  */
+double *WeightSnapshot::beginWrite()
+{
+    int published = current.fetchAndAddOrdered(0);
+    writing = (published == 0) ? 1 : 0;
+    sequence[writing].fetchAndAddOrdered(1);
+    return buffers[writing];
+}
+
+void WeightSnapshot::endWrite(unsigned int epoch)
+{
+    epochs[writing] = epoch;
+    sequence[writing].fetchAndAddOrdered(1);
+    current.fetchAndStoreOrdered(writing);
+}
+
+/**
+  * Copies the latest snapshot; false if none has been published yet.
+  */
+bool WeightSnapshot::read(vector<double> &weights, unsigned int &epoch) const
+{
+    weights.resize(numWeights);
+    forever
+    {
+        int b = current.fetchAndAddOrdered(0);
+        if(b < 0)
+            return false;
+
+        int before = sequence[b].fetchAndAddOrdered(0);
+        if(before % 2 != 0)
+            continue;
+        for(unsigned int n = 0; n < numWeights; n++)
+        {
+            weights[n] = buffers[b][n];
+        }
+        epoch = epochs[b];
+        if(sequence[b].fetchAndAddOrdered(0) == before)
+            return true;
+    }
+}
+
+const vector<unsigned int> &WeightSnapshot::getLayers() const
+{
+    return layers;
+}
+
+unsigned int WeightSnapshot::size() const
+{
+    return numWeights;
+}
+
+vector<double> WeightSnapshot::forward(const vector<double> &weights,
+                                       const vector<double> &input) const
+{
+    vector<double> below(input);
+    vector<double> out;
+    const double *w = &weights[0];
+    for(unsigned int i = 1; i < layers.size(); i++)
+    {
+        unsigned int p = layers[i-1];
+        out.resize(layers[i]);
+        for(unsigned int j = 0; j < layers[i]; j++)
+        {
+            const double *row = w + j*(p+1);
+            double sum = row[p];
+            for(unsigned int k = 0; k < p; k++)
+            {
+                sum += below[k] * row[k];
+            }
+            out[j] = 1.0/(1.0+exp(-sum));
+        }
+        w += layers[i]*(p+1);
+        below.swap(out);
+    }
+    return below;
+}
+
+/**
+  * The activations of every layer (the input first) for one input.
+  */
+vector<vector<double> > WeightSnapshot::activations(const vector<double> &weights,
+                                                    const vector<double> &input) const
+{
+    vector<vector<double> > vals(1, input);
+    const double *w = &weights[0];
+    for(unsigned int i = 1; i < layers.size(); i++)
+    {
+        unsigned int p = layers[i-1];
+        const vector<double> &below = vals[i-1];
+        vector<double> out(layers[i]);
+        for(unsigned int j = 0; j < layers[i]; j++)
+        {
+            const double *row = w + j*(p+1);
+            double sum = row[p];
+            for(unsigned int k = 0; k < p; k++)
+            {
+                sum += below[k] * row[k];
+            }
+            out[j] = 1.0/(1.0+exp(-sum));
+        }
+        w += layers[i]*(p+1);
+        vals.push_back(out);
+    }
+    return vals;
+}
+
+/**
+  * Summed absolute error over a dataset, the measure training epochs
+  * report, but with all samples seen by the same weights.
+  */
+double WeightSnapshot::error(const vector<double> &weights,
+                             const vector<vector<double> > &inputs,
+                             const vector<vector<double> > &expected) const
+{
+    double sum = 0.0;
+    for(unsigned int k = 0; k < inputs.size(); k++)
+    {
+        vector<double> output = forward(weights, inputs[k]);
+        sum += fabs(output[0] - expected[k][0]);
+    }
+    return sum;
+}
@@ -0,0 +1,52 @@
+#ifndef WEIGHTSNAPSHOT_H
+#define WEIGHTSNAPSHOT_H
+
+#include <vector>
+
+#include <QAtomicInt>
+
+/**
+  * Double-buffered copy of a network's weights. The training thread
+  * publishes snapshots, and any number of other threads can read them
+  * without ever blocking it (a seqlock per buffer). The writer fills the
+  * buffer that is not published, then flips which one is current. A
+  * reader copies the current buffer and retries if the writer has started
+  * overwriting it in the meantime, which can only happen after two more
+  * publishes.
+  *
+  * Weights are stored dense, in the same layout as FFNetwork::weights
+  * (pruned weights are zero). The forward pass and error helpers evaluate
+  * a copy obtained from read().
+  */
+class WeightSnapshot
+{
+public:
+    WeightSnapshot(const std::vector<unsigned int> &_layers);
+    ~WeightSnapshot();
+
+    double *beginWrite();
+    void endWrite(unsigned int epoch);
+    bool read(std::vector<double> &weights, unsigned int &epoch) const;
+
+    const std::vector<unsigned int> &getLayers() const;
+    unsigned int size() const;
+    std::vector<double> forward(const std::vector<double> &weights,
+                                const std::vector<double> &input) const;
+    std::vector<std::vector<double> > activations(const std::vector<double> &weights,
+                                                  const std::vector<double> &input) const;
+    double error(const std::vector<double> &weights,
+                 const std::vector<std::vector<double> > &inputs,
+                 const std::vector<std::vector<double> > &expected) const;
+
+private:
+    std::vector<unsigned int> layers;
+    unsigned int numWeights;
+    double *buffers[2];
+    unsigned int epochs[2];
+    // even when buffer b is stable, odd while it is being written
+    mutable QAtomicInt sequence[2];
+    mutable QAtomicInt current;
+    int writing;
+};
+
+#endif // WEIGHTSNAPSHOT_H